@@ -1,6 +1,9 @@
 #pragma once
 
+#include <map>
+#include <memory_resource>
 #include <mutex>
+#include <vector>
 
 template <typename Key, typename Value>
 class ConcurrentMap {
@@ -18,7 +21,9 @@ public:
         Value& ref_to_value;
     };
 
-    explicit ConcurrentMap(size_t bucket_count) : buckets_(bucket_count) {}
+    // Buckets are filled from several threads at once, so resource must be thread-safe
+    explicit ConcurrentMap(size_t bucket_count, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : buckets_(bucket_count, resource) {}
 
     Access operator[](const Key& key) {
         uint64_t bucket_index = static_cast<uint64_t>(key) % buckets_.size();
@@ -26,8 +31,8 @@ public:
         return {key, bucket};
     }
 
-    std::map<Key, Value> BuildOrdinaryMap() {
-        std::map<Key, Value> dst;
+    std::pmr::map<Key, Value> BuildOrdinaryMap() {
+        std::pmr::map<Key, Value> dst(buckets_.get_allocator());
         for (Bucket& item : buckets_) {
             std::lock_guard<std::mutex> guard(item.mtx);
             dst.merge(item.data);
@@ -38,6 +43,7 @@ public:
     void Erase(const Key& key) {
         uint64_t bucket_index = static_cast<uint64_t>(key) % buckets_.size();
         auto& bucket = buckets_[bucket_index];
+        std::lock_guard<std::mutex> guard(bucket.mtx);
         bucket.data.erase(key);
     }
 
@@ -45,9 +51,13 @@ public:
 
 private:
     struct Bucket {
+        using allocator_type = std::pmr::polymorphic_allocator<Bucket>;
+
+        explicit Bucket(const allocator_type& allocator) : data(allocator) {}
+
         std::mutex mtx;
-        std::map<Key, Value> data;
+        std::pmr::map<Key, Value> data;
     };
 
-    std::vector<Bucket> buckets_;
-};
\ No newline at end of file
+    std::pmr::vector<Bucket> buckets_;
+};
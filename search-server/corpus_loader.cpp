@@ -0,0 +1,150 @@
+#include "corpus_loader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <functional>
+#include <future>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const size_t CHUNK_SIZE = 4 << 20;
+
+struct CorpusRecord {
+    int id;
+    DocumentStatus status;
+    vector<int> ratings;
+    string_view text;
+    vector<PositionedWord> words;
+};
+
+string_view TakeField(string_view& line) {
+    const size_t end = line.find('\t');
+    if (end == string_view::npos) {
+        throw invalid_argument("Malformed corpus record "s + string(line.substr(0, 64)));
+    }
+    const string_view field = line.substr(0, end);
+    line.remove_prefix(end + 1);
+    return field;
+}
+
+int ParseInt(string_view text) {
+    int value = 0;
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc() || end != text.data() + text.size()) {
+        throw invalid_argument("Invalid number "s + string(text));
+    }
+    return value;
+}
+
+CorpusRecord ParseRecord(string_view line) {
+    CorpusRecord record;
+    record.id = ParseInt(TakeField(line));
+    record.status = ParseDocumentStatus(TakeField(line));
+    const string_view ratings = TakeField(line);
+    if (!ratings.empty() && ratings != "-"sv) {
+        size_t begin = 0;
+        while (begin <= ratings.size()) {
+            const size_t end = min(ratings.find(',', begin), ratings.size());
+            record.ratings.push_back(ParseInt(ratings.substr(begin, end - begin)));
+            begin = end + 1;
+        }
+    }
+    record.text = line;
+    return record;
+}
+
+// Parses and tokenizes the records, only adding them to the index is left to the caller
+vector<CorpusRecord> ParseChunk(const SearchServer& search_server, string_view chunk) {
+    vector<CorpusRecord> records;
+    while (!chunk.empty()) {
+        const size_t end = min(chunk.find('\n'), chunk.size());
+        string_view line = chunk.substr(0, end);
+        chunk.remove_prefix(min(end + 1, chunk.size()));
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            records.push_back(ParseRecord(line));
+            records.back().words = search_server.SplitIntoWordsNoStop(records.back().text);
+        }
+    }
+    return records;
+}
+
+// Cuts the next chunk of about CHUNK_SIZE bytes, extended to the end of a line
+string_view TakeChunk(string_view& data) {
+    size_t end = min(CHUNK_SIZE, data.size());
+    end = min(data.find('\n', end), data.size());
+    const string_view chunk = data.substr(0, end);
+    data.remove_prefix(min(end + 1, data.size()));
+    return chunk;
+}
+
+}
+
+MappedFile::MappedFile(const string& path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw system_error(errno, generic_category(), "open "s + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        const int error = errno;
+        close(fd);
+        throw system_error(error, generic_category(), "fstat "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            const int error = errno;
+            close(fd);
+            throw system_error(error, generic_category(), "mmap "s + path);
+        }
+        madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+string_view MappedFile::GetData() const {
+    return {data_, size_};
+}
+
+size_t LoadCorpus(SearchServer& search_server, const string& path) {
+    const auto file = make_shared<const MappedFile>(path);
+    string_view data = file->GetData();
+    const size_t parallelism = max(1u, thread::hardware_concurrency());
+
+    // Chunks of a window are parsed and tokenized concurrently, then indexed in file order,
+    // so only one window of parsed records is held at a time
+    size_t added = 0;
+    while (!data.empty()) {
+        vector<future<vector<CorpusRecord>>> window;
+        for (size_t i = 0; i < parallelism && !data.empty(); ++i) {
+            window.push_back(async(launch::async, ParseChunk, cref(search_server), TakeChunk(data)));
+        }
+        for (auto& parsed : window) {
+            for (const CorpusRecord& record : parsed.get()) {
+                search_server.AddDocument(record.id, record.text, record.status, record.ratings, file, record.words);
+                ++added;
+            }
+        }
+    }
+    return added;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "search_server.h"
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view GetData() const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Corpus format: one document per line, tab-separated fields
+//   <id>\t<status>\t<r1,r2,...|->\t<text>
+// The file is mapped and indexed without copying the text; the mapping stays
+// alive for as long as search_server references it. Returns the number of documents added.
+size_t LoadCorpus(SearchServer& search_server, const std::string& path);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+// Forwards to upstream and keeps allocation statistics; safe for concurrent use
+// as long as upstream is
+class CountingMemoryResource : public std::pmr::memory_resource {
+public:
+    explicit CountingMemoryResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream_(upstream) {
+    }
+
+    size_t GetAllocationCount() const {
+        return allocation_count_.load(std::memory_order_relaxed);
+    }
+
+    size_t GetDeallocationCount() const {
+        return deallocation_count_.load(std::memory_order_relaxed);
+    }
+
+    size_t GetBytesInUse() const {
+        return bytes_in_use_.load(std::memory_order_relaxed);
+    }
+
+    size_t GetPeakBytesInUse() const {
+        return peak_bytes_in_use_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::pmr::memory_resource* upstream_;
+    std::atomic<size_t> allocation_count_ = 0;
+    std::atomic<size_t> deallocation_count_ = 0;
+    std::atomic<size_t> bytes_in_use_ = 0;
+    std::atomic<size_t> peak_bytes_in_use_ = 0;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* pointer = upstream_->allocate(bytes, alignment);
+        allocation_count_.fetch_add(1, std::memory_order_relaxed);
+        const size_t in_use = bytes_in_use_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = peak_bytes_in_use_.load(std::memory_order_relaxed);
+        while (in_use > peak && !peak_bytes_in_use_.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {
+        }
+        return pointer;
+    }
+
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(pointer, bytes, alignment);
+        deallocation_count_.fetch_add(1, std::memory_order_relaxed);
+        bytes_in_use_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
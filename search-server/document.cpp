@@ -1,9 +1,30 @@
 #include "document.h"
 
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
 Document::Document() = default;
 
 Document::Document(int id, double relevance, int rating)
         : id(id)
         , relevance(relevance)
         , rating(rating) {
-}
\ No newline at end of file
+}
+
+DocumentStatus ParseDocumentStatus(string_view text) {
+    if (text == "ACTUAL"sv) {
+        return DocumentStatus::ACTUAL;
+    }
+    if (text == "IRRELEVANT"sv) {
+        return DocumentStatus::IRRELEVANT;
+    }
+    if (text == "BANNED"sv) {
+        return DocumentStatus::BANNED;
+    }
+    if (text == "REMOVED"sv) {
+        return DocumentStatus::REMOVED;
+    }
+    throw invalid_argument("Unknown document status "s + string(text));
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string_view>
+
 enum class DocumentStatus {
     ACTUAL,
     IRRELEVANT,
@@ -15,4 +17,7 @@ struct Document {
     int id = 0;
     double relevance = 0.0;
     int rating = 0;
-};
\ No newline at end of file
+};
+
+// Accepts the enumerator names, e.g. "ACTUAL"
+DocumentStatus ParseDocumentStatus(std::string_view text);
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+// Non-owning view of [begin, end); valid while the underlying container is not modified
+template <typename Iterator>
+class IteratorRange {
+public:
+    IteratorRange(Iterator begin, Iterator end) : begin_(begin), end_(end) {}
+
+    Iterator begin() const {
+        return begin_;
+    }
+
+    Iterator end() const {
+        return end_;
+    }
+
+    bool empty() const {
+        return begin_ == end_;
+    }
+
+    // Linear for non random access iterators
+    size_t size() const {
+        return std::distance(begin_, end_);
+    }
+
+private:
+    Iterator begin_;
+    Iterator end_;
+};
+
+// Iterates over the keys of a map
+template <typename MapIterator>
+class KeyIterator {
+public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = std::remove_const_t<typename std::iterator_traits<MapIterator>::value_type::first_type>;
+    using difference_type = typename std::iterator_traits<MapIterator>::difference_type;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    KeyIterator() = default;
+    explicit KeyIterator(MapIterator it) : it_(it) {}
+
+    reference operator*() const {
+        return it_->first;
+    }
+
+    pointer operator->() const {
+        return &it_->first;
+    }
+
+    KeyIterator& operator++() {
+        ++it_;
+        return *this;
+    }
+
+    KeyIterator operator++(int) {
+        return KeyIterator(it_++);
+    }
+
+    KeyIterator& operator--() {
+        --it_;
+        return *this;
+    }
+
+    KeyIterator operator--(int) {
+        return KeyIterator(it_--);
+    }
+
+    bool operator==(const KeyIterator& other) const {
+        return it_ == other.it_;
+    }
+
+    bool operator!=(const KeyIterator& other) const {
+        return it_ != other.it_;
+    }
+
+private:
+    MapIterator it_;
+};
@@ -0,0 +1,249 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct Options {
+    string unix_socket_path;
+    uint16_t tcp_port = 0;
+    int connections = 4;
+    int pipeline = 16;
+    int requests = 100000;
+    int populate = 0;
+    int query_words = 3;
+    int vocabulary = 2000;
+};
+
+class LineConnection {
+public:
+    explicit LineConnection(const Options& options) {
+        if (!options.unix_socket_path.empty()) {
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            strncpy(address.sun_path, options.unix_socket_path.c_str(), sizeof(address.sun_path) - 1);
+            fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+            Connect(reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        } else {
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(options.tcp_port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            fd_ = socket(AF_INET, SOCK_STREAM, 0);
+            Connect(reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        }
+    }
+
+    ~LineConnection() {
+        close(fd_);
+    }
+
+    void Send(const string& data) {
+        size_t sent_total = 0;
+        while (sent_total < data.size()) {
+            const ssize_t sent = send(fd_, data.data() + sent_total, data.size() - sent_total, MSG_NOSIGNAL);
+            if (sent == -1) {
+                throw system_error(errno, generic_category(), "send"s);
+            }
+            sent_total += sent;
+        }
+    }
+
+    string ReadLine() {
+        while (true) {
+            const size_t line_end = buffer_.find('\n', begin_);
+            if (line_end != string::npos) {
+                string line = buffer_.substr(begin_, line_end - begin_);
+                begin_ = line_end + 1;
+                return line;
+            }
+            buffer_.erase(0, begin_);
+            begin_ = 0;
+            char chunk[1 << 16];
+            const ssize_t received = recv(fd_, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                throw runtime_error("Connection closed by server"s);
+            }
+            buffer_.append(chunk, received);
+        }
+    }
+
+private:
+    int fd_ = -1;
+    string buffer_;
+    size_t begin_ = 0;
+
+    void Connect(sockaddr* address, socklen_t size) {
+        if (fd_ == -1 || connect(fd_, address, size) == -1) {
+            throw system_error(errno, generic_category(), "connect"s);
+        }
+    }
+};
+
+// Words are drawn uniformly from a synthetic vocabulary "w0" ... "w<size - 1>"
+string MakeText(mt19937& generator, int vocabulary, int word_count) {
+    uniform_int_distribution<int> word(0, vocabulary - 1);
+    string text;
+    for (int i = 0; i < word_count; ++i) {
+        if (i > 0) {
+            text += ' ';
+        }
+        text += 'w';
+        text += to_string(word(generator));
+    }
+    return text;
+}
+
+void Populate(const Options& options) {
+    LineConnection connection(options);
+    mt19937 generator(42);
+    string batch;
+    for (int id = 0; id < options.populate; ++id) {
+        batch += "ADD "s + to_string(id) + " ACTUAL "s + to_string(id % 10) + ","s + to_string(id % 7) + " "s + MakeText(generator, options.vocabulary, 10) + "\n"s;
+    }
+    connection.Send(batch);
+    for (int id = 0; id < options.populate; ++id) {
+        const string response = connection.ReadLine();
+        if (response != "OK"s) {
+            throw runtime_error("Populate failed: "s + response);
+        }
+    }
+}
+
+// Keeps `pipeline` requests in flight and records the latency of each response
+void RunConnection(const Options& options, int seed, atomic<int>& remaining, vector<int64_t>& latencies_us) {
+    LineConnection connection(options);
+    mt19937 generator(seed);
+    queue<Clock::time_point> in_flight;
+
+    auto send_next = [&]() {
+        if (remaining.fetch_sub(1) <= 0) {
+            return false;
+        }
+        in_flight.push(Clock::now());
+        connection.Send("SEARCH "s + MakeText(generator, options.vocabulary, options.query_words) + "\n"s);
+        return true;
+    };
+
+    for (int i = 0; i < options.pipeline && send_next(); ++i) {
+    }
+    while (!in_flight.empty()) {
+        const string response = connection.ReadLine();
+        latencies_us.push_back(chrono::duration_cast<chrono::microseconds>(Clock::now() - in_flight.front()).count());
+        in_flight.pop();
+        if (response.rfind("OK"s, 0) != 0) {
+            throw runtime_error("Search failed: "s + response);
+        }
+        send_next();
+    }
+}
+
+int64_t Percentile(const vector<int64_t>& sorted_values, double fraction) {
+    if (sorted_values.empty()) {
+        return 0;
+    }
+    const size_t index = min(sorted_values.size() - 1, static_cast<size_t>(fraction * sorted_values.size()));
+    return sorted_values[index];
+}
+
+void PrintUsage() {
+    cerr << "Usage: search_load_generator (--unix PATH | --port PORT) [--connections N] [--pipeline N] [--requests N] [--populate N] [--query-words N] [--vocabulary N]"s << endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintUsage();
+            return 1;
+        }
+        const string value = argv[++i];
+        if (arg == "--unix"s) {
+            options.unix_socket_path = value;
+        } else if (arg == "--port"s) {
+            options.tcp_port = static_cast<uint16_t>(stoi(value));
+        } else if (arg == "--connections"s) {
+            options.connections = stoi(value);
+        } else if (arg == "--pipeline"s) {
+            options.pipeline = stoi(value);
+        } else if (arg == "--requests"s) {
+            options.requests = stoi(value);
+        } else if (arg == "--populate"s) {
+            options.populate = stoi(value);
+        } else if (arg == "--query-words"s) {
+            options.query_words = stoi(value);
+        } else if (arg == "--vocabulary"s) {
+            options.vocabulary = stoi(value);
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (options.unix_socket_path.empty() && options.tcp_port == 0) {
+        PrintUsage();
+        return 1;
+    }
+
+    try {
+        if (options.populate > 0) {
+            Populate(options);
+        }
+
+        atomic<int> remaining(options.requests);
+        vector<vector<int64_t>> latencies_us(options.connections);
+        vector<thread> workers;
+        const auto start = Clock::now();
+        for (int i = 0; i < options.connections; ++i) {
+            workers.emplace_back([&, i]() {
+                try {
+                    RunConnection(options, i + 1, remaining, latencies_us[i]);
+                } catch (const exception& e) {
+                    cerr << e.what() << endl;
+                }
+            });
+        }
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        const double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+        vector<int64_t> all;
+        for (const auto& values : latencies_us) {
+            all.insert(all.end(), values.begin(), values.end());
+        }
+        sort(all.begin(), all.end());
+
+        cout << "requests: "s << all.size() << endl;
+        cout << "seconds: "s << seconds << endl;
+        cout << "qps: "s << all.size() / seconds << endl;
+        cout << "latency us p50: "s << Percentile(all, 0.5) << ", p90: "s << Percentile(all, 0.9)
+             << ", p99: "s << Percentile(all, 0.99) << ", p99.9: "s << Percentile(all, 0.999)
+             << ", max: "s << (all.empty() ? 0 : all.back()) << endl;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+// Node header of a red-black tree: color and three links
+const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);
+
+// Estimated bytes of the nodes of a std::map or std::set, not counting what the elements own
+template <typename Tree>
+size_t EstimateTreeNodeBytes(const Tree& tree) {
+    return tree.size() * (MAP_NODE_OVERHEAD + sizeof(typename Tree::value_type));
+}
+
+// Byte figures are estimates: node-based containers keep no exact accounting
+// and allocator rounding is not included
+struct MemoryStats {
+    size_t term_dictionary_bytes = 0;   // term map nodes and the front-coded prefix snapshot
+    size_t postings_bytes = 0;          // term -> (document, term_freq)
+    size_t forward_index_bytes = 0;     // document -> (term, term_freq)
+    size_t positional_index_bytes = 0;
+    size_t document_metadata_bytes = 0; // rating, status, length and the id set
+    size_t text_storage_bytes = 0;      // copies of added texts, zero-copy documents are not counted
+    size_t total_bytes = 0;
+
+    size_t term_count = 0;
+    size_t live_term_count = 0; // terms that still occur in some document
+    size_t posting_count = 0;
+    size_t document_count = 0;
+
+    double live_term_ratio = 0.0; // terms of removed documents keep their entries
+    double average_postings_per_term = 0.0;
+    double text_storage_fill_ratio = 0.0; // text bytes over the capacity of their buffers
+};
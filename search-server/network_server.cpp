@@ -0,0 +1,378 @@
+#include "network_server.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <system_error>
+
+#include "process_queries.h"
+#include "string_processing.h"
+
+using namespace std;
+
+namespace {
+
+void ThrowSystemError(const string& what) {
+    throw system_error(errno, generic_category(), what);
+}
+
+void SetNonBlocking(int fd) {
+    const int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        ThrowSystemError("fcntl"s);
+    }
+}
+
+// Splits off the first space-separated token of text
+string_view TakeToken(string_view& text) {
+    text.remove_prefix(min(text.find_first_not_of(' '), text.size()));
+    const size_t end = min(text.find(' '), text.size());
+    const string_view token = text.substr(0, end);
+    text.remove_prefix(end);
+    text.remove_prefix(min(text.find_first_not_of(' '), text.size()));
+    return token;
+}
+
+int ParseInt(string_view text) {
+    size_t parsed = 0;
+    const int value = stoi(string(text), &parsed);
+    if (parsed != text.size()) {
+        throw invalid_argument("Invalid number "s + string(text));
+    }
+    return value;
+}
+
+string FormatDocuments(const vector<Document>& documents) {
+    ostringstream out;
+    out << "OK "s << documents.size();
+    for (const Document& document : documents) {
+        out << ' ' << document.id << ' ' << document.relevance << ' ' << document.rating;
+    }
+    return out.str();
+}
+
+}
+
+NetworkServer::NetworkServer(SearchServer& search_server, const NetworkServerOptions& options)
+    : search_server_(search_server)
+    , options_(options) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ == -1) {
+        ThrowSystemError("epoll_create1"s);
+    }
+    stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd_ == -1) {
+        ThrowSystemError("eventfd"s);
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = stop_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_fd_, &event);
+
+    Listen();
+}
+
+NetworkServer::~NetworkServer() {
+    while (!connections_.empty()) {
+        CloseConnection(connections_.begin()->first);
+    }
+    if (listen_fd_ != -1) {
+        close(listen_fd_);
+    }
+    if (!unix_socket_path_.empty()) {
+        unlink(unix_socket_path_.c_str());
+    }
+    close(stop_fd_);
+    close(epoll_fd_);
+}
+
+void NetworkServer::Listen() {
+    if (!options_.unix_socket_path.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (options_.unix_socket_path.size() >= sizeof(address.sun_path)) {
+            throw invalid_argument("Unix socket path is too long"s);
+        }
+        strcpy(address.sun_path, options_.unix_socket_path.c_str());
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd_ == -1) {
+            ThrowSystemError("socket"s);
+        }
+        unlink(address.sun_path);
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1) {
+            ThrowSystemError("bind"s);
+        }
+        unix_socket_path_ = options_.unix_socket_path;
+    } else {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options_.tcp_port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd_ == -1) {
+            ThrowSystemError("socket"s);
+        }
+        const int enable = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1) {
+            ThrowSystemError("bind"s);
+        }
+    }
+
+    if (listen(listen_fd_, SOMAXCONN) == -1) {
+        ThrowSystemError("listen"s);
+    }
+    SetNonBlocking(listen_fd_);
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event) == -1) {
+        ThrowSystemError("epoll_ctl"s);
+    }
+}
+
+void NetworkServer::Run() {
+    const int max_events = 64;
+    epoll_event events[max_events];
+    bool running = true;
+    while (running) {
+        const int count = epoll_wait(epoll_fd_, events, max_events, -1);
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("epoll_wait"s);
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == stop_fd_) {
+                running = false;
+            } else if (fd == listen_fd_) {
+                AcceptConnections();
+            } else if (auto it = connections_.find(fd); it != connections_.end()) {
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    ReadConnection(fd, it->second);
+                }
+                if (events[i].events & EPOLLOUT) {
+                    WriteConnection(fd, it->second);
+                }
+            }
+        }
+
+        // Everything that arrived during this wake-up forms the micro-batch
+        ExecutePending();
+
+        for (auto it = connections_.begin(); it != connections_.end();) {
+            const int fd = it->first;
+            Connection& connection = it->second;
+            ++it;
+            if (!connection.output.empty()) {
+                WriteConnection(fd, connection);
+            }
+            if (connection.closing && connection.output.empty()) {
+                CloseConnection(fd);
+            } else {
+                UpdateInterest(fd, connection);
+            }
+        }
+    }
+}
+
+void NetworkServer::Stop() {
+    const uint64_t value = 1;
+    [[maybe_unused]] const auto written = write(stop_fd_, &value, sizeof(value));
+}
+
+void NetworkServer::AcceptConnections() {
+    while (true) {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return;
+            }
+            ThrowSystemError("accept4"s);
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == -1) {
+            close(fd);
+            continue;
+        }
+        connections_[fd].events = event.events;
+    }
+}
+
+void NetworkServer::ReadConnection(int fd, Connection& connection) {
+    // Reads at most one line limit per wake-up, and nothing while the client leaves its responses unread
+    char buffer[1 << 16];
+    while (!connection.closing && connection.input.size() <= MAX_LINE_SIZE && connection.output.size() < options_.max_output_size) {
+        const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            connection.input.append(buffer, received);
+        } else if (received == -1 && errno == EINTR) {
+            continue;
+        } else {
+            if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                connection.closing = true;
+            }
+            break;
+        }
+    }
+
+    // Complete lines become requests, several per read when the client pipelines
+    size_t line_begin = 0;
+    for (size_t line_end = connection.input.find('\n'); line_end != string::npos; line_end = connection.input.find('\n', line_begin)) {
+        size_t size = line_end - line_begin;
+        if (size > 0 && connection.input[line_end - 1] == '\r') {
+            --size;
+        }
+        pending_.push_back({fd, connection.input.substr(line_begin, size)});
+        line_begin = line_end + 1;
+    }
+    connection.input.erase(0, line_begin);
+
+    if (connection.input.size() > MAX_LINE_SIZE) {
+        connection.input.clear();
+        connection.output += "ERROR Request line is too long\n"s;
+        connection.closing = true;
+    }
+}
+
+void NetworkServer::WriteConnection(int fd, Connection& connection) {
+    size_t sent_total = 0;
+    while (sent_total < connection.output.size()) {
+        const ssize_t sent = send(fd, connection.output.data() + sent_total, connection.output.size() - sent_total, MSG_NOSIGNAL);
+        if (sent > 0) {
+            sent_total += sent;
+        } else if (sent == -1 && errno == EINTR) {
+            continue;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                connection.output.clear();
+                connection.closing = true;
+                return;
+            }
+            break;
+        }
+    }
+    connection.output.erase(0, sent_total);
+}
+
+void NetworkServer::ExecutePending() {
+    if (pending_.empty()) {
+        return;
+    }
+
+    vector<string> responses(pending_.size());
+    vector<string> batch_queries;
+    vector<size_t> batch_slots;
+    auto run_batch = [&]() {
+        if (batch_queries.empty()) {
+            return;
+        }
+        const auto outcomes = ProcessQueriesNoThrow(search_server_, batch_queries);
+        for (size_t i = 0; i < outcomes.size(); ++i) {
+            responses[batch_slots[i]] = outcomes[i].error.empty() ? FormatDocuments(outcomes[i].documents) : "ERROR "s + outcomes[i].error;
+        }
+        batch_queries.clear();
+        batch_slots.clear();
+    };
+
+    for (size_t i = 0; i < pending_.size(); ++i) {
+        string_view arguments = pending_[i].line;
+        const string_view command = TakeToken(arguments);
+        if (command == "SEARCH"sv) {
+            batch_queries.emplace_back(arguments);
+            batch_slots.push_back(i);
+            if (batch_queries.size() >= options_.max_batch_size) {
+                run_batch();
+            }
+        } else {
+            // Mutations and other commands must observe every search queued before them
+            run_batch();
+            responses[i] = ExecuteMutation(command, arguments);
+        }
+    }
+    run_batch();
+
+    for (size_t i = 0; i < pending_.size(); ++i) {
+        if (auto it = connections_.find(pending_[i].fd); it != connections_.end()) {
+            it->second.output += responses[i];
+            it->second.output += '\n';
+        }
+    }
+    pending_.clear();
+}
+
+string NetworkServer::ExecuteMutation(string_view command, string_view arguments) {
+    try {
+        if (command == "ADD"sv) {
+            const int document_id = ParseInt(TakeToken(arguments));
+            const DocumentStatus status = ParseDocumentStatus(TakeToken(arguments));
+            const string_view ratings_text = TakeToken(arguments);
+            vector<int> ratings;
+            if (ratings_text != "-"sv) {
+                size_t begin = 0;
+                while (begin <= ratings_text.size()) {
+                    const size_t end = min(ratings_text.find(',', begin), ratings_text.size());
+                    ratings.push_back(ParseInt(ratings_text.substr(begin, end - begin)));
+                    begin = end + 1;
+                }
+            }
+            search_server_.AddDocument(document_id, arguments, status, ratings);
+            return "OK"s;
+        }
+        if (command == "REMOVE"sv) {
+            const int document_id = ParseInt(TakeToken(arguments));
+            const int document_count = search_server_.GetDocumentCount();
+            search_server_.RemoveDocument(document_id);
+            if (search_server_.GetDocumentCount() == document_count) {
+                return "ERROR Unknown document id "s + to_string(document_id);
+            }
+            return "OK"s;
+        }
+        if (command == "COUNT"sv) {
+            return "OK "s + to_string(search_server_.GetDocumentCount());
+        }
+        return "ERROR Unknown command "s + string(command);
+    } catch (const exception& e) {
+        return "ERROR "s + e.what();
+    }
+}
+
+void NetworkServer::UpdateInterest(int fd, Connection& connection) {
+    // A half-closed socket stays readable, so a closing connection must not wait for input
+    uint32_t events = 0;
+    if (!connection.closing && connection.output.size() < options_.max_output_size) {
+        events |= EPOLLIN;
+    }
+    if (!connection.output.empty()) {
+        events |= EPOLLOUT;
+    }
+    if (events == connection.events) {
+        return;
+    }
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event);
+    connection.events = events;
+}
+
+void NetworkServer::CloseConnection(int fd) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections_.erase(fd);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+
+// Line protocol, one request per line, responses in request order per connection:
+//   SEARCH <raw query>                          -> OK <count> [<id> <relevance> <rating>]...
+//   ADD <id> <status> <r1,r2,...|-> <text>      -> OK
+//   REMOVE <id>                                 -> OK
+//   COUNT                                       -> OK <document count>
+// Any failure is answered with ERROR <message>.
+struct NetworkServerOptions {
+    std::string unix_socket_path; // takes precedence over tcp_port when set
+    uint16_t tcp_port = 0;        // bound to the loopback interface
+    size_t max_batch_size = 256;
+    size_t max_output_size = 1 << 20; // reading from a connection pauses while more response bytes wait
+};
+
+// Single-threaded epoll event loop. All requests read during one wake-up are
+// executed in arrival order, consecutive searches are run as one ProcessQueries batch.
+class NetworkServer {
+public:
+    NetworkServer(SearchServer& search_server, const NetworkServerOptions& options);
+    ~NetworkServer();
+
+    NetworkServer(const NetworkServer&) = delete;
+    NetworkServer& operator=(const NetworkServer&) = delete;
+
+    void Run();
+
+    // Safe to call from another thread or a signal handler
+    void Stop();
+
+private:
+    struct Connection {
+        std::string input;
+        std::string output;
+        uint32_t events = 0; // registered with epoll
+        bool closing = false;
+    };
+
+    struct PendingRequest {
+        int fd;
+        std::string line;
+    };
+
+    static const size_t MAX_LINE_SIZE = 1 << 20;
+
+    SearchServer& search_server_;
+    NetworkServerOptions options_;
+    std::string unix_socket_path_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int stop_fd_ = -1;
+    std::map<int, Connection> connections_;
+    std::vector<PendingRequest> pending_;
+
+    void Listen();
+    void AcceptConnections();
+    void ReadConnection(int fd, Connection& connection);
+    void WriteConnection(int fd, Connection& connection);
+    void ExecutePending();
+    std::string ExecuteMutation(std::string_view command, std::string_view arguments);
+    void UpdateInterest(int fd, Connection& connection);
+    void CloseConnection(int fd);
+};
@@ -0,0 +1,58 @@
+#include "page_cursor.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+void AppendHex(string& dst, uint64_t value, int digits) {
+    for (int i = digits - 1; i >= 0; --i) {
+        dst.push_back(HEX_DIGITS[(value >> (i * 4)) & 0xF]);
+    }
+}
+
+uint64_t ParseHex(string_view text) {
+    uint64_t value = 0;
+    for (const char c : text) {
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        } else {
+            throw invalid_argument("Invalid page cursor"s);
+        }
+    }
+    return value;
+}
+
+}
+
+string EncodePageCursor(const Document& last_document) {
+    uint64_t relevance_bits;
+    memcpy(&relevance_bits, &last_document.relevance, sizeof(relevance_bits));
+
+    string cursor;
+    cursor.reserve(32);
+    AppendHex(cursor, relevance_bits, 16);
+    AppendHex(cursor, static_cast<uint32_t>(last_document.rating), 8);
+    AppendHex(cursor, static_cast<uint32_t>(last_document.id), 8);
+    return cursor;
+}
+
+Document DecodePageCursor(string_view cursor) {
+    if (cursor.size() != 32) {
+        throw invalid_argument("Invalid page cursor"s);
+    }
+    const uint64_t relevance_bits = ParseHex(cursor.substr(0, 16));
+    double relevance;
+    memcpy(&relevance, &relevance_bits, sizeof(relevance));
+    const int rating = static_cast<int>(static_cast<uint32_t>(ParseHex(cursor.substr(16, 8))));
+    const int id = static_cast<int>(static_cast<uint32_t>(ParseHex(cursor.substr(24, 8))));
+    return {id, relevance, rating};
+}
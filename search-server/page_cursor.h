@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+struct SearchPage {
+    std::vector<Document> documents;
+    std::string next_cursor; // empty on the last page
+};
+
+// The cursor is an opaque hex token holding the (relevance, rating, id) of the last document on a page
+std::string EncodePageCursor(const Document& last_document);
+
+Document DecodePageCursor(std::string_view cursor);
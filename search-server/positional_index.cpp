@@ -0,0 +1,203 @@
+#include "positional_index.h"
+
+#include <algorithm>
+
+#include "memory_stats.h"
+
+using namespace std;
+
+PositionList::Cursor::Cursor(const PositionList& list) : list_(&list) {
+    if (!AtEnd()) {
+        Decode();
+    }
+}
+
+bool PositionList::Cursor::AtEnd() const {
+    return index_ >= list_->size_;
+}
+
+uint32_t PositionList::Cursor::Value() const {
+    return value_;
+}
+
+void PositionList::Cursor::Next() {
+    ++index_;
+    if (!AtEnd()) {
+        Decode();
+    }
+}
+
+void PositionList::Cursor::SkipTo(uint32_t target) {
+    if (AtEnd() || value_ >= target) {
+        return;
+    }
+
+    // Gallop over the skip entries lying ahead of the cursor, then binary search the last jump
+    const auto& skips = list_->skips_;
+    const size_t first = (index_ + 1) / SKIP_INTERVAL;
+    size_t bound = 1;
+    while (first + bound <= skips.size() && skips[first + bound - 1].position < target) {
+        bound *= 2;
+    }
+    const auto range_begin = skips.begin() + first;
+    const auto range_end = skips.begin() + min(first + bound, skips.size());
+    const auto it = partition_point(range_begin, range_end, [target](const SkipEntry& entry) {
+        return entry.position < target;
+    });
+    if (it != range_begin) {
+        const SkipEntry& entry = *prev(it);
+        index_ = entry.index;
+        offset_ = entry.offset;
+        value_ = entry.position;
+    }
+
+    while (!AtEnd() && value_ < target) {
+        Next();
+    }
+}
+
+void PositionList::Cursor::Decode() {
+    uint32_t delta = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = list_->bytes_[offset_++];
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    value_ += delta;
+}
+
+PositionList::PositionList(const allocator_type& allocator)
+    : bytes_(allocator)
+    , skips_(allocator) {
+}
+
+PositionList::PositionList(const PositionList& other, const allocator_type& allocator)
+    : bytes_(other.bytes_, allocator)
+    , skips_(other.skips_, allocator)
+    , size_(other.size_)
+    , last_position_(other.last_position_) {
+}
+
+PositionList::PositionList(PositionList&& other, const allocator_type& allocator)
+    : bytes_(std::move(other.bytes_), allocator)
+    , skips_(std::move(other.skips_), allocator)
+    , size_(other.size_)
+    , last_position_(other.last_position_) {
+}
+
+void PositionList::Append(uint32_t position) {
+    uint32_t delta = position - last_position_;
+    while (delta >= 0x80) {
+        bytes_.push_back(static_cast<uint8_t>(delta | 0x80));
+        delta >>= 7;
+    }
+    bytes_.push_back(static_cast<uint8_t>(delta));
+
+    if ((size_ + 1) % SKIP_INTERVAL == 0) {
+        skips_.push_back({position, size_, static_cast<uint32_t>(bytes_.size())});
+    }
+    last_position_ = position;
+    ++size_;
+}
+
+size_t PositionList::Size() const {
+    return size_;
+}
+
+size_t PositionList::GetMemoryUsage() const {
+    return bytes_.capacity() + skips_.capacity() * sizeof(SkipEntry);
+}
+
+PositionList::Cursor PositionList::GetCursor() const {
+    return Cursor(*this);
+}
+
+PositionalIndex::PositionalIndex(pmr::memory_resource* resource) : word_to_document_positions_(resource) {
+}
+
+void PositionalIndex::AddDocument(int document_id, const vector<PositionedWord>& words) {
+    for (const auto& [word, position] : words) {
+        word_to_document_positions_[word][document_id].Append(position);
+    }
+}
+
+bool PositionalIndex::ContainsPhrase(int document_id, const Phrase& phrase) const {
+    vector<PositionList::Cursor> cursors;
+    cursors.reserve(phrase.size());
+    for (const PhraseTerm& term : phrase) {
+        const PositionList* positions = FindPositions(term.word, document_id);
+        if (positions == nullptr) {
+            return false;
+        }
+        cursors.push_back(positions->GetCursor());
+    }
+
+    // Leapfrog: every term proposes the phrase start it can support,
+    // until all of them agree on the same one
+    uint32_t start = 0;
+    size_t agreed = 0;
+    for (size_t i = 0; agreed < phrase.size(); i = (i + 1) % phrase.size()) {
+        const uint32_t target = start + phrase[i].offset;
+        cursors[i].SkipTo(target);
+        if (cursors[i].AtEnd()) {
+            return false;
+        }
+        if (cursors[i].Value() == target) {
+            ++agreed;
+        } else {
+            start = cursors[i].Value() - phrase[i].offset;
+            agreed = 1;
+        }
+    }
+    return true;
+}
+
+bool PositionalIndex::ContainsNear(int document_id, const Proximity& proximity) const {
+    const PositionList* lhs_positions = FindPositions(proximity.lhs, document_id);
+    const PositionList* rhs_positions = FindPositions(proximity.rhs, document_id);
+    if (lhs_positions == nullptr || rhs_positions == nullptr) {
+        return false;
+    }
+
+    auto lhs = lhs_positions->GetCursor();
+    auto rhs = rhs_positions->GetCursor();
+    while (!lhs.AtEnd() && !rhs.AtEnd()) {
+        if (lhs.Value() < rhs.Value()) {
+            if (rhs.Value() - lhs.Value() <= proximity.distance) {
+                return true;
+            }
+            lhs.SkipTo(rhs.Value() - proximity.distance);
+        } else {
+            if (lhs.Value() - rhs.Value() <= proximity.distance) {
+                return true;
+            }
+            rhs.SkipTo(lhs.Value() - proximity.distance);
+        }
+    }
+    return false;
+}
+
+size_t PositionalIndex::GetMemoryUsage() const {
+    size_t bytes = EstimateTreeNodeBytes(word_to_document_positions_);
+    for (const auto& [word, document_positions] : word_to_document_positions_) {
+        bytes += EstimateTreeNodeBytes(document_positions);
+        for (const auto& [document_id, positions] : document_positions) {
+            bytes += positions.GetMemoryUsage();
+        }
+    }
+    return bytes;
+}
+
+const PositionList* PositionalIndex::FindPositions(const string& word, int document_id) const {
+    const auto word_it = word_to_document_positions_.find(word);
+    if (word_it == word_to_document_positions_.end()) {
+        return nullptr;
+    }
+    const auto document_it = word_it->second.find(document_id);
+    if (document_it == word_it->second.end()) {
+        return nullptr;
+    }
+    return &document_it->second;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct PositionedWord {
+    std::string_view word;
+    uint32_t position;
+};
+
+// Increasing in-document positions stored as varint-encoded deltas.
+// Every SKIP_INTERVAL-th position is mirrored into a skip table, so a cursor
+// can gallop over whole runs of encoded bytes instead of decoding them.
+class PositionList {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    explicit PositionList(const allocator_type& allocator = {});
+    PositionList(const PositionList& other, const allocator_type& allocator);
+    PositionList(PositionList&& other, const allocator_type& allocator);
+
+    class Cursor {
+    public:
+        explicit Cursor(const PositionList& list);
+
+        bool AtEnd() const;
+        uint32_t Value() const;
+        void Next();
+        // Moves to the first position not less than target
+        void SkipTo(uint32_t target);
+
+    private:
+        const PositionList* list_;
+        uint32_t index_ = 0;
+        size_t offset_ = 0; // offset of the next encoded delta
+        uint32_t value_ = 0;
+
+        void Decode();
+    };
+
+    void Append(uint32_t position); // positions must be appended in increasing order
+
+    size_t Size() const;
+
+    size_t GetMemoryUsage() const; // bytes allocated for the encoded positions and skips
+
+    Cursor GetCursor() const;
+
+private:
+    static const uint32_t SKIP_INTERVAL = 8;
+
+    struct SkipEntry {
+        uint32_t position;
+        uint32_t index;
+        uint32_t offset; // offset just past the encoded delta of this position
+    };
+
+    std::pmr::vector<uint8_t> bytes_;
+    std::pmr::vector<SkipEntry> skips_;
+    uint32_t size_ = 0;
+    uint32_t last_position_ = 0;
+};
+
+class PositionalIndex {
+public:
+    struct PhraseTerm {
+        std::string word;
+        uint32_t offset; // position inside the phrase, stop words included
+    };
+
+    using Phrase = std::vector<PhraseTerm>;
+
+    struct Proximity {
+        std::string lhs;
+        std::string rhs;
+        uint32_t distance;
+    };
+
+    explicit PositionalIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    void AddDocument(int document_id, const std::vector<PositionedWord>& words);
+
+    template <typename WordContainer>
+    void RemoveDocument(int document_id, const WordContainer& words);
+
+    bool ContainsPhrase(int document_id, const Phrase& phrase) const;
+
+    bool ContainsNear(int document_id, const Proximity& proximity) const;
+
+    // Estimate including the map nodes, std::map keeps no exact accounting
+    size_t GetMemoryUsage() const;
+
+private:
+    std::pmr::map<std::string_view, std::pmr::map<int, PositionList>> word_to_document_positions_;
+
+    const PositionList* FindPositions(const std::string& word, int document_id) const;
+};
+
+template <typename WordContainer>
+void PositionalIndex::RemoveDocument(int document_id, const WordContainer& words) {
+    for (const auto& [word, _] : words) {
+        const auto it = word_to_document_positions_.find(word);
+        if (it != word_to_document_positions_.end()) {
+            it->second.erase(document_id);
+        }
+    }
+}
@@ -12,6 +12,23 @@ vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const
     return dst;
 }
 
+vector<QueryOutcome> ProcessQueriesNoThrow(const SearchServer& search_server, const vector<string>& queries) {
+    vector<QueryOutcome> dst(queries.size());
+
+    // An exception escaping a parallel algorithm terminates the program, so it is caught per query
+    transform(execution::par, queries.begin(), queries.end(), dst.begin(), [&search_server](const string& s) {
+        QueryOutcome outcome;
+        try {
+            outcome.documents = search_server.FindTopDocuments(s);
+        } catch (const exception& e) {
+            outcome.error = e.what();
+        }
+        return outcome;
+    });
+
+    return dst;
+}
+
 list<Document> ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries) {
     list<Document> dst;
 
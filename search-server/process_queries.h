@@ -8,4 +8,12 @@
 
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
 
-std::list<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
\ No newline at end of file
+std::list<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+
+struct QueryOutcome {
+    std::vector<Document> documents;
+    std::string error; // non-empty if the query was rejected
+};
+
+// Unlike ProcessQueries, a malformed query does not abort the whole batch
+std::vector<QueryOutcome> ProcessQueriesNoThrow(const SearchServer& search_server, const std::vector<std::string>& queries);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Ranking policies are template parameters of SearchServer::FindTopDocuments, so each
+// of them gets its own scan loop with the scoring inlined into it. A policy is built
+// once per query from the collection statistics:
+//   Ranking(int document_count, double average_document_length)
+//   double ComputeInverseDocumentFreq(size_t document_freq) const
+//   double ComputeScore(double term_freq, double inverse_document_freq, uint32_t document_length) const
+// where term_freq is the share of the document's words equal to the term.
+
+class TfIdfRanking {
+public:
+    TfIdfRanking(int document_count, double average_document_length) : document_count_(document_count) {}
+
+    double ComputeInverseDocumentFreq(size_t document_freq) const {
+        return std::log(document_count_ * 1.0 / document_freq);
+    }
+
+    double ComputeScore(double term_freq, double inverse_document_freq, uint32_t document_length) const {
+        return term_freq * inverse_document_freq;
+    }
+
+private:
+    int document_count_;
+};
+
+// Okapi BM25 with the Lucene variant of IDF, which stays positive for common terms
+class Bm25Ranking {
+public:
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    Bm25Ranking(int document_count, double average_document_length)
+        : document_count_(document_count)
+        , length_norm_base_(K1 * (1.0 - B))
+        , length_norm_factor_(average_document_length > 0.0 ? K1 * B / average_document_length : 0.0) {
+    }
+
+    double ComputeInverseDocumentFreq(size_t document_freq) const {
+        return std::log(1.0 + (document_count_ - static_cast<double>(document_freq) + 0.5) / (document_freq + 0.5));
+    }
+
+    double ComputeScore(double term_freq, double inverse_document_freq, uint32_t document_length) const {
+        const double term_count = term_freq * document_length;
+        const double length_norm = length_norm_base_ + length_norm_factor_ * document_length;
+        return inverse_document_freq * term_count * (K1 + 1.0) / (term_count + length_norm);
+    }
+
+private:
+    int document_count_;
+    double length_norm_base_;
+    double length_norm_factor_;
+};
@@ -1,28 +1,27 @@
 #include "remove_duplicates.h"
 
+#include <algorithm>
+
 void RemoveDuplicates(SearchServer& search_server) {
+    using TermRange = SearchServer::TermRange;
+
     std::vector<int> need_remove;
 
-    std::set<std::set<std::string_view>> words_in_documents;
+    // Term sets are compared through views into the index, nothing is copied per document.
+    // The views stay valid since documents are removed only after the scan.
+    const auto terms_less = [](const TermRange& lhs, const TermRange& rhs) {
+        return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    };
+    std::set<TermRange, decltype(terms_less)> words_in_documents(terms_less);
 
     for (const int document_id : search_server) {
-        const std::map<std::string_view, double> word_to_freq = search_server.GetWordFrequencies(document_id);
-
-        std::set<std::string_view> temp_words_set;
-        for (const auto [word, freq] : word_to_freq) {
-            temp_words_set.insert(word);
-        }
-
-        if (words_in_documents.count(temp_words_set)) {
+        if (!words_in_documents.insert(search_server.GetDocumentTerms(document_id)).second) {
             std::cout << "Found duplicate document id "s << document_id << std::endl;
             need_remove.push_back(document_id);
         }
-        else {
-            words_in_documents.insert(temp_words_set);
-        }
     }
 
     for (auto id : need_remove) {
         search_server.RemoveDocument(id);
     }
-}
\ No newline at end of file
+}
@@ -1,40 +1,118 @@
 #include "request_queue.h"
 
+#include <algorithm>
+#include <thread>
+
 using namespace std;
 
-RequestQueue::RequestQueue(SearchServer& search_server) : search_server_(&search_server) {
+RequestQueue::RequestQueue(SearchServer& search_server, chrono::steady_clock::duration slot_duration, size_t slot_count)
+    : search_server_(&search_server)
+    , slot_duration_(slot_duration)
+    , slots_(slot_count) {
+    if (slot_duration <= chrono::steady_clock::duration::zero() || slot_count == 0) {
+        throw invalid_argument("Request window must not be empty"s);
+    }
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    request_count_++;
-    if (request_count_ < min_in_day_) {
-        requests_.pop_front();
-        request_count_--;
+    const auto start = chrono::steady_clock::now();
+    auto documents = search_server_->FindTopDocuments(raw_query, status);
+    RecordRequest(documents.size(), chrono::steady_clock::now() - start);
+    return documents;
+}
+
+std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
+}
+
+int RequestQueue::GetNoResultRequests() const {
+    return GetStats().no_result_requests;
+}
+
+RequestStats RequestQueue::GetStats() const {
+    ExpireSlots(GetCurrentEpoch());
+
+    const auto total = [this](size_t counter) {
+        return static_cast<uint64_t>(max<int64_t>(0, totals_[counter].load(memory_order_relaxed)));
+    };
+    RequestStats stats;
+    stats.requests = total(REQUESTS);
+    stats.no_result_requests = total(NO_RESULT_REQUESTS);
+    stats.returned_documents = total(RETURNED_DOCUMENTS);
+    for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+        stats.latency_buckets[i] = total(FIRST_LATENCY_BUCKET + i);
     }
-    requests_.push_back({search_server_->FindTopDocuments(raw_query, status)});
+    return stats;
+}
 
-    return search_server_->FindTopDocuments(raw_query, status);
+int64_t RequestQueue::GetCurrentEpoch() const {
+    return chrono::steady_clock::now().time_since_epoch() / slot_duration_;
 }
 
-std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
-    request_count_++;
-    if (request_count_ > min_in_day_) {
-        requests_.pop_front();
-        request_count_--;
+void RequestQueue::RecordRequest(size_t result_count, chrono::steady_clock::duration latency) {
+    const int64_t epoch = GetCurrentEpoch();
+    Slot& slot = slots_[epoch % slots_.size()];
+    for (int64_t current = slot.epoch.load(memory_order_acquire); current != epoch; current = slot.epoch.load(memory_order_acquire)) {
+        if (current > epoch) {
+            // The slot moved on to a later period while this request was running
+            return;
+        }
+        if (current == RESETTING_EPOCH) {
+            this_thread::yield();
+            continue;
+        }
+        // The first request of a period recycles the slot its predecessor used a window ago
+        ReleaseSlot(slot, current, epoch);
+    }
+
+    const int64_t micros = chrono::duration_cast<chrono::microseconds>(latency).count();
+    size_t latency_bucket = 0;
+    while (latency_bucket + 1 < LATENCY_BUCKET_COUNT && (int64_t{2} << latency_bucket) <= micros) {
+        ++latency_bucket;
     }
-    requests_.push_back({search_server_->FindTopDocuments(raw_query)});
 
-    return search_server_->FindTopDocuments(raw_query);
+    const auto add = [this, &slot](size_t counter, int64_t value) {
+        slot.counters[counter].fetch_add(value, memory_order_relaxed);
+        totals_[counter].fetch_add(value, memory_order_relaxed);
+    };
+    add(REQUESTS, 1);
+    if (result_count == 0) {
+        add(NO_RESULT_REQUESTS, 1);
+    }
+    add(RETURNED_DOCUMENTS, result_count);
+    add(FIRST_LATENCY_BUCKET + latency_bucket, 1);
 }
 
-int RequestQueue::GetNoResultRequests() const {
-    int dst_count = 0;
-    auto requests_copy = requests_;
-    while (!requests_copy.empty()) {
-        if (requests_copy.back().top_docs.size() == 0) {
-            dst_count += 1;
+bool RequestQueue::ReleaseSlot(Slot& slot, int64_t expected_epoch, int64_t new_epoch) const {
+    if (!slot.epoch.compare_exchange_strong(expected_epoch, RESETTING_EPOCH, memory_order_acquire)) {
+        return false;
+    }
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        const int64_t value = slot.counters[i].exchange(0, memory_order_relaxed);
+        if (value != 0) {
+            totals_[i].fetch_sub(value, memory_order_relaxed);
+        }
+    }
+    slot.epoch.store(new_epoch, memory_order_release);
+    return true;
+}
+
+void RequestQueue::ExpireSlots(int64_t now_epoch) const {
+    const int64_t slot_count = slots_.size();
+    const int64_t window_begin = now_epoch - slot_count + 1;
+    int64_t expired_until = expired_until_.load(memory_order_acquire);
+    if (expired_until >= window_begin) {
+        return;
+    }
+
+    // Each slot is visited at most once per window, so the cost is amortized over the elapsed slots
+    for (int64_t epoch = max(expired_until, window_begin - slot_count); epoch < window_begin; ++epoch) {
+        Slot& slot = slots_[epoch % slot_count];
+        const int64_t current = slot.epoch.load(memory_order_acquire);
+        if (current >= 0 && current < window_begin) {
+            ReleaseSlot(slot, current, EMPTY_EPOCH);
         }
-        requests_copy.pop_back();
     }
-    return dst_count;
-}
\ No newline at end of file
+    while (expired_until < window_begin && !expired_until_.compare_exchange_weak(expired_until, window_begin, memory_order_release)) {
+    }
+}
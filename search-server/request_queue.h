@@ -1,7 +1,10 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <vector>
-#include <queue>
 #include <iostream>
 
 #include "search_server.h"
@@ -25,9 +28,24 @@ std::ostream& std::operator<<(ostream& out, pair<Iterator, Iterator> documents_o
     return out;
 }
 
+const size_t LATENCY_BUCKET_COUNT = 24;
+
+struct RequestStats {
+    uint64_t requests = 0;
+    uint64_t no_result_requests = 0;
+    uint64_t returned_documents = 0;
+    // Bucket i counts requests that took [2^i, 2^(i+1)) microseconds, the first bucket
+    // also takes faster ones and the last one slower ones
+    std::array<uint64_t, LATENCY_BUCKET_COUNT> latency_buckets{};
+};
+
+// Statistics of the requests made during the last slot_count * slot_duration.
+// Requests are aggregated into per-slot atomic counters and window totals,
+// so recording and reading are lock-free and may run from any number of threads.
 class RequestQueue {
 public:
-    explicit RequestQueue(SearchServer& search_server);
+    explicit RequestQueue(SearchServer& search_server, std::chrono::steady_clock::duration slot_duration = std::chrono::minutes(1), size_t slot_count = 1440);
+
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
 
@@ -36,24 +54,48 @@ public:
     std::vector<Document> AddFindRequest(const std::string& raw_query);
     
     int GetNoResultRequests() const;
+
+    RequestStats GetStats() const;
+
 private:
-    struct QueryResult {
-        std::vector<Document> top_docs;
+    enum Counter {
+        REQUESTS,
+        NO_RESULT_REQUESTS,
+        RETURNED_DOCUMENTS,
+        FIRST_LATENCY_BUCKET,
+        COUNTER_COUNT = FIRST_LATENCY_BUCKET + LATENCY_BUCKET_COUNT,
+    };
+
+    // Slot epochs below zero are states rather than time
+    static const int64_t EMPTY_EPOCH = -1;
+    static const int64_t RESETTING_EPOCH = -2;
+
+    struct Slot {
+        std::atomic<int64_t> epoch{EMPTY_EPOCH}; // number of the time slot the counters belong to
+        std::array<std::atomic<int64_t>, COUNTER_COUNT> counters{};
     };
-    std::deque<QueryResult> requests_;
-    const static int min_in_day_ = 1440;
-    int request_count_ = 0;
+
     SearchServer* search_server_;
+    const std::chrono::steady_clock::duration slot_duration_;
+    // Slot of epoch e is slots_[e % slots_.size()]
+    mutable std::vector<Slot> slots_;
+    // Sums over the live slots; may dip below zero for a moment while a slot is recycled
+    mutable std::array<std::atomic<int64_t>, COUNTER_COUNT> totals_{};
+    // Epochs below it are already subtracted from the totals
+    mutable std::atomic<int64_t> expired_until_{0};
+
+    int64_t GetCurrentEpoch() const;
+    void RecordRequest(size_t result_count, std::chrono::steady_clock::duration latency);
+    // Claims the slot if it still holds expected_epoch and subtracts its counters from the totals
+    bool ReleaseSlot(Slot& slot, int64_t expected_epoch, int64_t new_epoch) const;
+    // Releases the slots that dropped out of the window before now_epoch
+    void ExpireSlots(int64_t now_epoch) const;
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-    request_count_++;
-    if (request_count_ < min_in_day_) {
-        requests_.pop_front();
-        request_count_--;
-    }
-    requests_.push_back({search_server_->FindTopDocuments(raw_query, document_predicate)});
-
-    return search_server_->FindTopDocuments(raw_query, document_predicate);
-}
\ No newline at end of file
+    const auto start = std::chrono::steady_clock::now();
+    auto documents = search_server_->FindTopDocuments(raw_query, document_predicate);
+    RecordRequest(documents.size(), std::chrono::steady_clock::now() - start);
+    return documents;
+}
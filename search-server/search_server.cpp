@@ -2,9 +2,23 @@
 
 using namespace std;
 
-SearchServer::SearchServer(const std::string& stop_words_text) : SearchServer(SplitIntoWords(stop_words_text)) {}
+SearchServer::SearchServer(const std::string& stop_words_text, pmr::memory_resource* resource) : SearchServer(SplitIntoWords(stop_words_text), resource) {}
 
-SearchServer::SearchServer(const std::string_view& stop_words_view) : SearchServer(SplitIntoWords(string(stop_words_view))) {}
+SearchServer::SearchServer(const std::string_view& stop_words_view, pmr::memory_resource* resource) : SearchServer(SplitIntoWords(string(stop_words_view)), resource) {}
+
+void SearchServer::EnablePositionalIndex() {
+    if (!documents_.empty()) {
+        throw logic_error("Positional index must be enabled before adding documents"s);
+    }
+    positional_index_enabled_ = true;
+}
+
+void SearchServer::SetQueryResourceProvider(QueryResourceProvider provider) {
+    if (!provider) {
+        throw invalid_argument("Query resource provider is empty"s);
+    }
+    query_resource_provider_ = std::move(provider);
+}
 
 void SearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings) {
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
@@ -12,26 +26,91 @@ void SearchServer::AddDocument(int document_id, const std::string_view& document
     }
     
     global_storage_.emplace_back(std::move(document));
-    const auto words = SplitIntoWordsNoStop(global_storage_.back());
+    const string_view text = global_storage_.back();
+    IndexDocument(document_id, text, status, ratings, SplitIntoWordsNoStop(text));
+}
 
+void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings, std::shared_ptr<const void> storage_owner) {
+    AddDocument(document_id, document, status, ratings, std::move(storage_owner), SplitIntoWordsNoStop(document));
+}
+
+void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings, std::shared_ptr<const void> storage_owner, const std::vector<PositionedWord>& words) {
+    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+
+    if (external_storage_.empty() || external_storage_.back() != storage_owner) {
+        external_storage_.push_back(std::move(storage_owner));
+    }
+    IndexDocument(document_id, document, status, ratings, words);
+}
+
+void SearchServer::IndexDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings, const std::vector<PositionedWord>& words) {
     const double inv_word_count = 1.0 / words.size();
-    for (const string_view& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
+    // Present even when every word is a stop word, so RemoveDocument finds it
+    auto& word_freqs = document_to_word_freqs_[document_id];
+    for (const auto& [word, position] : words) {
+        auto& document_freqs = word_to_document_freqs_[word];
+        if (document_freqs.empty()) {
+            new_terms_.insert(word);
+            ++term_changes_;
+        }
+        document_freqs[document_id] += inv_word_count;
+        word_freqs[word] += inv_word_count;
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, global_storage_.back()});
+    if (positional_index_enabled_) {
+        positional_index_.AddDocument(document_id, words);
+    }
+    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, document, static_cast<uint32_t>(words.size())});
+    total_document_length_ += words.size();
     document_ids_.insert(document_id);
+    UpdateTermDictionary();
 }
 
-vector<Document> SearchServer::FindTopDocuments(const string_view& raw_query, DocumentStatus status) const {
-    return FindTopDocuments(
-        raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-            return document_status == status;
-        });
+void SearchServer::TermStatistics::Merge(const TermStatistics& other) {
+    document_count += other.document_count;
+    total_document_length += other.total_document_length;
+    for (const auto& [word, document_freq] : other.word_document_freqs) {
+        word_document_freqs[word] += document_freq;
+    }
+    for (const auto& [prefix, document_freq] : other.prefix_document_freqs) {
+        prefix_document_freqs[prefix] += document_freq;
+    }
 }
 
-vector<Document> SearchServer::FindTopDocuments(const string_view& raw_query) const {
-    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+SearchServer::TermStatistics SearchServer::GetTermStatistics(const string_view& raw_query) const {
+    const auto query = ParseQuery(raw_query);
+
+    TermStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    statistics.total_document_length = total_document_length_;
+    for (const auto& word : query.plus_words) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it != word_to_document_freqs_.end() && !it->second.empty()) {
+            statistics.word_document_freqs.emplace(word, it->second.size());
+        }
+    }
+    for (const auto& prefix : query.plus_prefixes) {
+        const size_t document_freq = MergePrefixPostings(prefix).size();
+        if (document_freq > 0) {
+            statistics.prefix_document_freqs.emplace(prefix, document_freq);
+        }
+    }
+    CollectClauseStatistics(query.boolean_clauses, statistics);
+    return statistics;
+}
+
+bool SearchServer::RanksHigher(const Document& lhs, const Document& rhs) {
+    // Fixed buckets rather than a tolerance keep the order transitive, which sorting and cursors rely on
+    const int64_t lhs_relevance = llround(lhs.relevance / TEN_POWER_MINUS_SIX);
+    const int64_t rhs_relevance = llround(rhs.relevance / TEN_POWER_MINUS_SIX);
+    if (lhs_relevance != rhs_relevance) {
+        return lhs_relevance > rhs_relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
 }
 
 int SearchServer::GetDocumentCount() const {
@@ -43,20 +122,30 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const str
 }
 
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const execution::sequenced_policy&, const string_view& raw_query, int document_id) const {
-    static const auto query = ParseQuery(raw_query, true);
+    const auto query = ParseQuery(raw_query, true);
 
     vector<string_view> matched_words;
 
-    for (const string& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+    // Matched words are returned as views of the index keys, the query itself is a temporary
+    for (const auto& word : query.plus_words) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it != word_to_document_freqs_.end() && it->second.count(document_id)) {
+            matched_words.push_back(it->first);
         }
     }
 
-    for (const string& word : query.minus_words) {
+    for (const auto& prefix : query.plus_prefixes) {
+        ForEachPrefixExpansion(prefix, [&matched_words, document_id](string_view term, const auto& document_freqs) {
+            if (document_freqs.count(document_id)) {
+                matched_words.push_back(term);
+            }
+        });
+    }
+    CollectClauseWords(query.boolean_clauses, document_id, matched_words);
+    sort(matched_words.begin(), matched_words.end());
+    matched_words.erase(unique(matched_words.begin(), matched_words.end()), matched_words.end());
+
+    for (const auto& word : query.minus_words) {
         if (word_to_document_freqs_.count(word) == 0) {
             continue;
         }
@@ -66,11 +155,15 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const exe
         }
     }
 
+    if (HasMinusPrefixMatch(query, document_id) || !MatchesPositionalConstraints(query, document_id) || !MatchesBooleanClauses(query, document_id)) {
+        matched_words.clear();
+    }
+
     return {matched_words, documents_.at(document_id).status};
 }
 
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const execution::parallel_policy&, const string_view& raw_query, int document_id) const {
-    static const auto query = ParseQuery(raw_query, false);
+    const auto query = ParseQuery(raw_query, false);
 
     bool flag = any_of(execution::par, query.minus_words.begin(), query.minus_words.end(), [this, document_id](const auto& entry) {
         return word_to_document_freqs_.count(entry) && word_to_document_freqs_.at(entry).count(document_id);
@@ -78,7 +171,7 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const exe
 
     vector<string_view> matched_words;
 
-    if (flag) {
+    if (flag || HasMinusPrefixMatch(query, document_id) || !MatchesPositionalConstraints(query, document_id) || !MatchesBooleanClauses(query, document_id)) {
         return {matched_words, documents_.at(document_id).status};
     }
 
@@ -89,6 +182,19 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const exe
     });
 
     matched_words.resize(std::distance(matched_words.begin(), it));
+    transform(execution::par, matched_words.begin(), matched_words.end(), matched_words.begin(), [this](string_view word) {
+        return word_to_document_freqs_.find(word)->first;
+    });
+
+    for (const auto& prefix : query.plus_prefixes) {
+        ForEachPrefixExpansion(prefix, [&matched_words, document_id](string_view term, const auto& document_freqs) {
+            if (document_freqs.count(document_id)) {
+                matched_words.push_back(term);
+            }
+        });
+    }
+
+    CollectClauseWords(query.boolean_clauses, document_id, matched_words);
 
     sort(execution::par, matched_words.begin(), matched_words.end());
     matched_words.erase(unique(execution::par, matched_words.begin(), matched_words.end()), matched_words.end());
@@ -97,30 +203,101 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const exe
 }
 
 
-std::set<int>::const_iterator SearchServer::begin() const {
+pmr::set<int>::const_iterator SearchServer::begin() const {
     return document_ids_.begin();
 }
 
-std::set<int>::const_iterator SearchServer::end() const {
+pmr::set<int>::const_iterator SearchServer::end() const {
     return document_ids_.end();
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(const int document_id) const {
+const pmr::map<string_view, double>& SearchServer::GetWordFrequencies(const int document_id) const {
     if (document_to_word_freqs_.count(document_id)) {
         return document_to_word_freqs_.at(document_id);
     }
-    static std::map<std::string_view, double> empty_map;
+    static const pmr::map<string_view, double> empty_map;
     return empty_map;
 }
 
+SearchServer::TermRange SearchServer::GetDocumentTerms(int document_id) const {
+    const auto it = document_to_word_freqs_.find(document_id);
+    if (it == document_to_word_freqs_.end()) {
+        static const pmr::map<string_view, double> empty_map;
+        return {KeyIterator(empty_map.begin()), KeyIterator(empty_map.end())};
+    }
+    return {KeyIterator(it->second.begin()), KeyIterator(it->second.end())};
+}
+
+SearchServer::PostingRange SearchServer::GetTermPostings(string_view term) const {
+    const auto it = word_to_document_freqs_.find(term);
+    if (it == word_to_document_freqs_.end()) {
+        static const pmr::map<int, double> empty_map;
+        return {empty_map.begin(), empty_map.end()};
+    }
+    return {it->second.begin(), it->second.end()};
+}
+
+MemoryStats SearchServer::GetMemoryStats() const {
+    MemoryStats stats;
+
+    stats.term_count = word_to_document_freqs_.size();
+    stats.term_dictionary_bytes = EstimateTreeNodeBytes(word_to_document_freqs_);
+    stats.term_dictionary_bytes += term_dictionary_.GetMemoryUsage() + EstimateTreeNodeBytes(new_terms_);
+
+    for (const auto& [word, document_freqs] : word_to_document_freqs_) {
+        stats.postings_bytes += EstimateTreeNodeBytes(document_freqs);
+        stats.posting_count += document_freqs.size();
+        if (!document_freqs.empty()) {
+            ++stats.live_term_count;
+        }
+    }
+
+    stats.forward_index_bytes = EstimateTreeNodeBytes(document_to_word_freqs_);
+    for (const auto& [document_id, word_freqs] : document_to_word_freqs_) {
+        stats.forward_index_bytes += EstimateTreeNodeBytes(word_freqs);
+    }
+
+    if (positional_index_enabled_) {
+        stats.positional_index_bytes = positional_index_.GetMemoryUsage();
+    }
+
+    stats.document_count = documents_.size();
+    stats.document_metadata_bytes = EstimateTreeNodeBytes(documents_) + EstimateTreeNodeBytes(document_ids_);
+
+    size_t text_size = 0;
+    size_t text_capacity = 0;
+    for (const auto& text : global_storage_) {
+        text_size += text.size();
+        text_capacity += text.capacity();
+    }
+    stats.text_storage_bytes = global_storage_.size() * sizeof(pmr::string) + text_capacity;
+
+    stats.total_bytes = stats.term_dictionary_bytes + stats.postings_bytes + stats.forward_index_bytes
+        + stats.positional_index_bytes + stats.document_metadata_bytes + stats.text_storage_bytes;
+
+    if (stats.term_count > 0) {
+        stats.live_term_ratio = stats.live_term_count * 1.0 / stats.term_count;
+    }
+    if (stats.live_term_count > 0) {
+        stats.average_postings_per_term = stats.posting_count * 1.0 / stats.live_term_count;
+    }
+    if (text_capacity > 0) {
+        stats.text_storage_fill_ratio = text_size * 1.0 / text_capacity;
+    }
+    return stats;
+}
+
 void SearchServer::RemoveDocument(const execution::sequenced_policy&, const int document_id) {
     RemoveDocument(document_id);
 }
 
 void SearchServer::RemoveDocument(const execution::parallel_policy&, const int document_id) {
-    vector<string_view> words(document_to_word_freqs_[document_id].size());
+    if (documents_.count(document_id) == 0) {
+        return;
+    }
 
-    map<string_view, double>& word_to_freqs = document_to_word_freqs_.at(document_id);
+    pmr::map<string_view, double>& word_to_freqs = document_to_word_freqs_.at(document_id);
+    vector<string_view> words(word_to_freqs.size());
 
     transform(execution::par, word_to_freqs.begin(), word_to_freqs.end(), words.begin(), [](const auto& entry) {
         return entry.first;
@@ -131,7 +308,15 @@ void SearchServer::RemoveDocument(const execution::parallel_policy&, const int d
             word_to_document_freqs_.at(entry_word).erase(document_id);
         }
     });
+    term_changes_ += count_if(words.begin(), words.end(), [this](string_view word) {
+        return word_to_document_freqs_.at(word).empty();
+    });
 
+    if (positional_index_enabled_) {
+        positional_index_.RemoveDocument(document_id, document_to_word_freqs_.at(document_id));
+    }
+
+    total_document_length_ -= documents_.at(document_id).length;
     documents_.erase(document_id);
 
     for (auto it = document_ids_.begin(); it != document_ids_.end(); ++it) {
@@ -142,13 +327,27 @@ void SearchServer::RemoveDocument(const execution::parallel_policy&, const int d
     }
 
     document_to_word_freqs_.erase(document_id);
+    UpdateTermDictionary();
 }
 
 void SearchServer::RemoveDocument(const int document_id) {
+    if (documents_.count(document_id) == 0) {
+        return;
+    }
+
     for (auto& [word, freqs] : document_to_word_freqs_.at(document_id)) {
-        word_to_document_freqs_.at(word).erase(document_id);
+        auto& document_freqs = word_to_document_freqs_.at(word);
+        document_freqs.erase(document_id);
+        if (document_freqs.empty()) {
+            ++term_changes_;
+        }
     }
     
+    if (positional_index_enabled_) {
+        positional_index_.RemoveDocument(document_id, document_to_word_freqs_.at(document_id));
+    }
+
+    total_document_length_ -= documents_.at(document_id).length;
     documents_.erase(document_id);
 
     for (auto it = document_ids_.begin(); it != document_ids_.end(); ++it) {
@@ -159,28 +358,32 @@ void SearchServer::RemoveDocument(const int document_id) {
     }
 
     document_to_word_freqs_.erase(document_id);
+    UpdateTermDictionary();
 }
 
-bool SearchServer::IsStopWord(const std::string& word) const {
+bool SearchServer::IsStopWord(string_view word) const {
     return stop_words_.count(word) > 0;
 }
 
-bool SearchServer::IsValidWord(const std::string& word) {
+bool SearchServer::IsValidWord(string_view word) {
     // A valid word must not contain special characters
     return none_of(word.begin(), word.end(), [](char c) {
         return c >= '\0' && c < ' ';
     });
 }
 
-vector<string_view> SearchServer::SplitIntoWordsNoStop(const string_view& text) const {
-    vector<string_view> words;
+vector<PositionedWord> SearchServer::SplitIntoWordsNoStop(const string_view& text) const {
+    vector<PositionedWord> words;
+    uint32_t position = 0;
     for (const string_view& word : SplitIntoWords(text)) {
-        if (!IsValidWord(string(word))) {
+        if (!IsValidWord(word)) {
             throw invalid_argument("Word "s + string(word) + " is invalid"s);
         }
-        if (!IsStopWord(string(word))) {
-            words.push_back(word);
+        if (!IsStopWord(word)) {
+            words.push_back({word, position});
         }
+        // Stop words still occupy a position, so phrases keep their gaps
+        ++position;
     }
     return words;
 }
@@ -203,22 +406,81 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string& text) co
         is_minus = true;
         word = word.substr(1);
     }
+    bool is_prefix = false;
+    if (!word.empty() && word.back() == '*') {
+        is_prefix = true;
+        word.pop_back();
+    }
     if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
         throw invalid_argument("Query word "s + text + " is invalid");
     }
 
-    return {word, is_minus, IsStopWord(word)};
+    return {word, is_minus, !is_prefix && IsStopWord(word), is_prefix};
 }
 
 SearchServer::Query SearchServer::ParseQuery(const std::string_view& text, bool sort_flag) const {
-    Query result;
-    for (const string_view& word : SplitIntoWords(text)) {
-        const auto query_word = ParseQueryWord(string(word));
-        if (!query_word.is_stop) {
+    Query result(GetQueryResource());
+    const vector<string_view> words = SplitIntoQueryTokens(text);
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (words[i].front() == '"') {
+            i = ParsePhrase(words, i, result) - 1;
+            continue;
+        }
+        if (IsSignedPhrase(words[i])) {
+            throw invalid_argument("Phrases cannot be required or excluded in query "s + string(text));
+        }
+
+        if (IsGroupOpening(words[i])) {
+            QueryClause group;
+            i = ParseGroup(words, i, 1, group) - 1;
+            if (!group.clauses.empty()) {
+                result.boolean_clauses.push_back(move(group));
+            }
+            continue;
+        }
+        if (words[i] == ")"sv) {
+            throw invalid_argument("Unbalanced parentheses in query "s + string(text));
+        }
+        uint32_t distance = 0;
+        // NEAR binds two plain words only; any other use is rejected rather than searched as a term
+        if (IsNearOperator(words[i], distance) || (i + 1 < words.size() && IsNearOperator(words[i + 1], distance) && !IsNearOperand(words, i + 2))) {
+            throw invalid_argument("NEAR must stand between two plain words in query "s + string(text));
+        }
+        if (words[i].front() == '+') {
+            if (auto clause = ParseClause(words[i])) {
+                result.boolean_clauses.push_back(move(*clause));
+            }
+            continue;
+        }
+
+        if (i + 1 < words.size() && IsNearOperator(words[i + 1], distance)) {
+            // The right operand is parsed on the next step, so "a NEAR/2 b NEAR/2 c" chains
+            const auto lhs = ParseQueryWord(string(words[i]));
+            const auto rhs = ParseQueryWord(string(words[i + 2]));
+            if (lhs.is_minus || lhs.is_stop || lhs.is_prefix || rhs.is_minus || rhs.is_stop || rhs.is_prefix) {
+                throw invalid_argument("Invalid NEAR operands in query "s + string(text));
+            }
+            if (!positional_index_enabled_) {
+                throw invalid_argument("NEAR queries require the positional index"s);
+            }
+            result.plus_words.emplace_back(lhs.data);
+            result.proximities.push_back({lhs.data, rhs.data, distance});
+            ++i;
+            continue;
+        }
+
+        const auto query_word = ParseQueryWord(string(words[i]));
+        if (query_word.is_prefix) {
+            if (query_word.is_minus) {
+                result.minus_prefixes.emplace_back(query_word.data);
+            } else {
+                result.plus_prefixes.emplace_back(query_word.data);
+            }
+        } else if (!query_word.is_stop) {
             if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
+                result.minus_words.emplace_back(query_word.data);
             } else {
-                result.plus_words.push_back(query_word.data);
+                result.plus_words.emplace_back(query_word.data);
             }
         }
     }
@@ -229,11 +491,371 @@ SearchServer::Query SearchServer::ParseQuery(const std::string_view& text, bool
 
         sort(result.plus_words.begin(), result.plus_words.end());
         result.plus_words.erase(unique(result.plus_words.begin(), result.plus_words.end()), result.plus_words.end());
+
+        sort(result.minus_prefixes.begin(), result.minus_prefixes.end());
+        result.minus_prefixes.erase(unique(result.minus_prefixes.begin(), result.minus_prefixes.end()), result.minus_prefixes.end());
+
+        sort(result.plus_prefixes.begin(), result.plus_prefixes.end());
+        result.plus_prefixes.erase(unique(result.plus_prefixes.begin(), result.plus_prefixes.end()), result.plus_prefixes.end());
     }
 
     return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const string& word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+size_t SearchServer::ParsePhrase(const vector<string_view>& words, size_t begin, Query& query) const {
+    PositionalIndex::Phrase phrase;
+    uint32_t offset = 0;
+    bool closed = false;
+    size_t i = begin;
+    for (; i < words.size() && !closed; ++i) {
+        string_view word = words[i];
+        if (i == begin) {
+            word.remove_prefix(1);
+        }
+        if (!word.empty() && word.back() == '"') {
+            word.remove_suffix(1);
+            closed = true;
+        }
+        if (word.empty()) {
+            continue;
+        }
+
+        // Phrase words are literal, so quoting a document word like (beta), +1 or -2 finds it
+        if (!IsValidWord(word)) {
+            throw invalid_argument("Query word "s + string(word) + " is invalid"s);
+        }
+        if (!IsStopWord(word)) {
+            phrase.push_back({string(word), offset});
+        }
+        ++offset;
+    }
+
+    if (!closed) {
+        throw invalid_argument("Unterminated phrase in query"s);
+    }
+
+    const uint32_t first_offset = phrase.empty() ? 0 : phrase.front().offset;
+    for (PositionalIndex::PhraseTerm& term : phrase) {
+        query.plus_words.emplace_back(term.word);
+        term.offset -= first_offset;
+    }
+    if (phrase.size() > 1) {
+        if (!positional_index_enabled_) {
+            throw invalid_argument("Phrase queries require the positional index"s);
+        }
+        query.phrases.push_back(move(phrase));
+    }
+    return i;
+}
+
+bool SearchServer::IsNearOperator(const string_view& word, uint32_t& distance) {
+    const string_view prefix = "NEAR/"sv;
+    if (word.size() <= prefix.size() || word.substr(0, prefix.size()) != prefix) {
+        return false;
+    }
+    const string_view digits = word.substr(prefix.size());
+    if (!all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; }) || digits.size() > 9) {
+        return false;
+    }
+    distance = static_cast<uint32_t>(stoul(string(digits)));
+    return true;
+}
+
+bool SearchServer::IsNearOperand(const vector<string_view>& tokens, size_t index) {
+    uint32_t distance = 0;
+    return index < tokens.size() && tokens[index].front() != '+' && tokens[index].front() != '"'
+        && !IsGroupOpening(tokens[index]) && tokens[index] != ")"sv && !IsNearOperator(tokens[index], distance);
+}
+
+vector<string_view> SearchServer::SplitIntoQueryTokens(const string_view& text) {
+    vector<string_view> tokens;
+    bool in_phrase = false;
+    for (string_view word : SplitIntoWords(text)) {
+        // Phrase words are kept whole, parentheses inside quotes are part of the words
+        if (in_phrase || word.front() == '"') {
+            in_phrase = !(word.back() == '"' && (in_phrase || word.size() > 1));
+            tokens.push_back(word);
+            continue;
+        }
+        while (!word.empty()) {
+            const size_t opening_size = word.front() == '(' ? 1 : IsGroupOpening(word.substr(0, 2)) ? 2 : 0;
+            if (opening_size == 0) {
+                break;
+            }
+            tokens.push_back(word.substr(0, opening_size));
+            word.remove_prefix(opening_size);
+        }
+
+        size_t closing_count = 0;
+        while (closing_count < word.size() && word[word.size() - 1 - closing_count] == ')') {
+            ++closing_count;
+        }
+        if (closing_count < word.size()) {
+            tokens.push_back(word.substr(0, word.size() - closing_count));
+        }
+        for (size_t i = 0; i < closing_count; ++i) {
+            tokens.push_back(")"sv);
+        }
+    }
+    return tokens;
+}
+
+bool SearchServer::IsGroupOpening(const string_view& token) {
+    return token == "("sv || token == "+("sv || token == "-("sv;
+}
+
+bool SearchServer::IsSignedPhrase(const string_view& token) {
+    return token.size() > 1 && (token[0] == '+' || token[0] == '-') && token[1] == '"';
+}
+
+size_t SearchServer::ParseGroup(const vector<string_view>& tokens, size_t begin, int depth, QueryClause& group) const {
+    if (depth > MAX_QUERY_GROUP_DEPTH) {
+        throw invalid_argument("Query groups are nested too deeply"s);
+    }
+    group.occur = tokens[begin] == "+("sv ? Occur::MUST : tokens[begin] == "-("sv ? Occur::MUST_NOT : Occur::SHOULD;
+
+    size_t i = begin + 1;
+    while (i < tokens.size() && tokens[i] != ")"sv) {
+        if (IsGroupOpening(tokens[i])) {
+            QueryClause member;
+            i = ParseGroup(tokens, i, depth + 1, member);
+            if (!member.clauses.empty()) {
+                group.clauses.push_back(move(member));
+            }
+            continue;
+        }
+
+        uint32_t distance = 0;
+        if (tokens[i].front() == '"' || IsSignedPhrase(tokens[i]) || IsNearOperator(tokens[i], distance)) {
+            throw invalid_argument("Phrases and NEAR are not allowed inside groups"s);
+        }
+        if (auto clause = ParseClause(tokens[i])) {
+            group.clauses.push_back(move(*clause));
+        }
+        ++i;
+    }
+
+    if (i == tokens.size()) {
+        throw invalid_argument("Unbalanced parentheses in query"s);
+    }
+    return i + 1;
+}
+
+optional<SearchServer::QueryClause> SearchServer::ParseClause(string_view token) const {
+    const bool is_required = token.front() == '+';
+    if (is_required) {
+        token.remove_prefix(1);
+    }
+    const auto query_word = ParseQueryWord(string(token));
+    if (is_required && query_word.is_minus) {
+        throw invalid_argument("Query word +"s + string(token) + " is invalid"s);
+    }
+    if (query_word.is_stop) {
+        return nullopt;
+    }
+
+    QueryClause clause;
+    clause.occur = is_required ? Occur::MUST : query_word.is_minus ? Occur::MUST_NOT : Occur::SHOULD;
+    clause.term = query_word.data;
+    clause.is_prefix = query_word.is_prefix;
+    return clause;
+}
+
+void SearchServer::UpdateGroupEstimate(BoundClause& group) {
+    optional<size_t> rarest_required;
+    size_t optional_total = 0;
+    for (const BoundClause& member : group.clauses) {
+        if (member.occur == Occur::MUST) {
+            rarest_required = min(rarest_required.value_or(member.estimated_size), member.estimated_size);
+        } else if (member.occur == Occur::SHOULD) {
+            optional_total += member.estimated_size;
+        }
+    }
+    group.estimated_size = rarest_required.value_or(optional_total);
+}
+
+void SearchServer::CollectCandidates(const BoundClause& clause, pmr::vector<int>& candidates) const {
+    if (clause.word_postings != nullptr) {
+        for (const auto [document_id, _] : *clause.word_postings) {
+            candidates.push_back(document_id);
+        }
+        return;
+    }
+    if (!clause.is_group) {
+        for (const auto& [document_id, _] : clause.prefix_postings) {
+            candidates.push_back(document_id);
+        }
+        return;
+    }
+
+    const BoundClause* rarest_required = nullptr;
+    for (const BoundClause& member : clause.clauses) {
+        if (member.occur == Occur::MUST && (rarest_required == nullptr || member.estimated_size < rarest_required->estimated_size)) {
+            rarest_required = &member;
+        }
+    }
+    if (rarest_required != nullptr) {
+        CollectCandidates(*rarest_required, candidates);
+        return;
+    }
+
+    const size_t begin = candidates.size();
+    for (const BoundClause& member : clause.clauses) {
+        if (member.occur == Occur::SHOULD) {
+            CollectCandidates(member, candidates);
+        }
+    }
+    sort(candidates.begin() + begin, candidates.end());
+    candidates.erase(unique(candidates.begin() + begin, candidates.end()), candidates.end());
+}
+
+bool SearchServer::MatchesBooleanClauses(const Query& query, int document_id) const {
+    if (query.boolean_clauses.empty()) {
+        return true;
+    }
+    const auto ranking = MakeRanking<TfIdfRanking>(query);
+    return ScoreClause(BindQuery(query, ranking), document_id, documents_.at(document_id).length, ranking).has_value();
+}
+
+void SearchServer::CollectClauseWords(const vector<QueryClause>& clauses, int document_id, vector<string_view>& matched_words) const {
+    for (const QueryClause& clause : clauses) {
+        if (clause.occur == Occur::MUST_NOT) {
+            continue;
+        }
+        if (clause.term.empty()) {
+            CollectClauseWords(clause.clauses, document_id, matched_words);
+        } else if (clause.is_prefix) {
+            ForEachPrefixExpansion(clause.term, [&matched_words, document_id](string_view term, const auto& document_freqs) {
+                if (document_freqs.count(document_id)) {
+                    matched_words.push_back(term);
+                }
+            });
+        } else if (const auto it = word_to_document_freqs_.find(clause.term); it != word_to_document_freqs_.end() && it->second.count(document_id)) {
+            matched_words.push_back(it->first);
+        }
+    }
+}
+
+void SearchServer::CollectClauseStatistics(const vector<QueryClause>& clauses, TermStatistics& statistics) const {
+    for (const QueryClause& clause : clauses) {
+        if (clause.occur == Occur::MUST_NOT) {
+            continue;
+        }
+        if (clause.term.empty()) {
+            CollectClauseStatistics(clause.clauses, statistics);
+        } else if (clause.is_prefix) {
+            const size_t document_freq = MergePrefixPostings(clause.term).size();
+            if (document_freq > 0) {
+                statistics.prefix_document_freqs.emplace(clause.term, document_freq);
+            }
+        } else if (const auto it = word_to_document_freqs_.find(clause.term); it != word_to_document_freqs_.end() && !it->second.empty()) {
+            statistics.word_document_freqs.emplace(clause.term, it->second.size());
+        }
+    }
+}
+
+bool SearchServer::HasMinusPrefixMatch(const Query& query, int document_id) const {
+    bool found = false;
+    for (const auto& prefix : query.minus_prefixes) {
+        ForEachPrefixExpansion(prefix, [&found, document_id](string_view, const auto& document_freqs) {
+            found = found || document_freqs.count(document_id) > 0;
+        });
+    }
+    return found;
+}
+
+bool SearchServer::MatchesPositionalConstraints(const Query& query, int document_id) const {
+    return all_of(query.phrases.begin(), query.phrases.end(), [this, document_id](const auto& phrase) {
+            return positional_index_.ContainsPhrase(document_id, phrase);
+        })
+        && all_of(query.proximities.begin(), query.proximities.end(), [this, document_id](const auto& proximity) {
+            return positional_index_.ContainsNear(document_id, proximity);
+        });
+}
+
+void SearchServer::ApplyPositionalConstraints(const Query& query, pmr::map<int, double>& document_to_relevance) const {
+    if (query.phrases.empty() && query.proximities.empty()) {
+        return;
+    }
+    for (auto it = document_to_relevance.begin(); it != document_to_relevance.end();) {
+        if (MatchesPositionalConstraints(query, it->first)) {
+            ++it;
+        } else {
+            it = document_to_relevance.erase(it);
+        }
+    }
+}
+
+pmr::memory_resource* SearchServer::GetThreadQueryPool() {
+    thread_local pmr::unsynchronized_pool_resource resource;
+    return &resource;
+}
+
+pmr::memory_resource* SearchServer::GetQueryResource() const {
+    return query_resource_provider_();
+}
+
+void SearchServer::UpdateTermDictionary() {
+    if (term_changes_ < max(MIN_TERM_DICTIONARY_REBUILD, term_dictionary_.Size() / 8)) {
+        return;
+    }
+    vector<string_view> terms;
+    for (const auto& [word, document_freqs] : word_to_document_freqs_) {
+        if (!document_freqs.empty()) {
+            terms.push_back(word);
+        }
+    }
+    term_dictionary_ = TermDictionary(terms);
+    new_terms_.clear();
+    term_changes_ = 0;
+}
+
+pmr::vector<pair<int, double>> SearchServer::MergePrefixPostings(string_view prefix) const {
+    using PostingIterator = pmr::map<int, double>::const_iterator;
+    pmr::memory_resource* resource = GetQueryResource();
+    pmr::vector<pair<PostingIterator, PostingIterator>> postings(resource);
+    ForEachPrefixExpansion(prefix, [&postings](string_view, const pmr::map<int, double>& document_freqs) {
+        postings.push_back({document_freqs.begin(), document_freqs.end()});
+    });
+
+    // Min-heap of (document id, posting index) keeps the k-way merge ordered by document id
+    priority_queue<pair<int, size_t>, pmr::vector<pair<int, size_t>>, greater<>> heap{greater<>(), pmr::vector<pair<int, size_t>>(resource)};
+    for (size_t i = 0; i < postings.size(); ++i) {
+        heap.push({postings[i].first->first, i});
+    }
+
+    pmr::vector<pair<int, double>> merged(resource);
+    while (!heap.empty()) {
+        const auto [document_id, index] = heap.top();
+        heap.pop();
+        auto& [it, end] = postings[index];
+        if (merged.empty() || merged.back().first != document_id) {
+            merged.push_back({document_id, 0.0});
+        }
+        merged.back().second += it->second;
+        if (++it != end) {
+            heap.push({it->first, index});
+        }
+    }
+    return merged;
+}
+
+size_t SearchServer::GetWordDocumentFreq(const Query& query, string_view word) const {
+    if (query.statistics != nullptr) {
+        const auto it = query.statistics->word_document_freqs.find(word);
+        if (it != query.statistics->word_document_freqs.end()) {
+            return it->second;
+        }
+    }
+    return word_to_document_freqs_.at(word).size();
+}
+
+size_t SearchServer::GetPrefixDocumentFreq(const Query& query, string_view prefix, size_t local_document_freq) const {
+    if (query.statistics != nullptr) {
+        const auto it = query.statistics->prefix_document_freqs.find(prefix);
+        if (it != query.statistics->prefix_document_freqs.end()) {
+            return it->second;
+        }
+    }
+    return local_document_freq;
 }
\ No newline at end of file
@@ -12,53 +12,139 @@
 #include <queue>
 #include <type_traits>
 #include <future>
+#include <memory>
+#include <memory_resource>
+#include <set>
+#include <deque>
+#include <optional>
+#include <functional>
 
 #include "string_processing.h"
 #include "document.h"
 #include "concurrent_map.h"
+#include "positional_index.h"
+#include "term_dictionary.h"
+#include "page_cursor.h"
+#include "iterator_range.h"
+#include "memory_stats.h"
+#include "ranking.h"
 
 using namespace std::literals;
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
+const size_t MAX_PREFIX_EXPANSION = 64;
+const size_t MIN_TERM_DICTIONARY_REBUILD = 256;
 const double TEN_POWER_MINUS_SIX = 1e-6;
+const int MAX_QUERY_GROUP_DEPTH = 32;
 
 class SearchServer {
 public:
     using tuple_matched_words_and_status = std::tuple<std::vector<std::string_view>, DocumentStatus>;
+    using TermRange = IteratorRange<KeyIterator<std::pmr::map<std::string_view, double>::const_iterator>>;
+    using PostingRange = IteratorRange<std::pmr::map<int, double>::const_iterator>;
+
+    // Collection-wide counts the ranking depends on. Servers holding disjoint parts
+    // of one collection merge theirs, so each of them ranks as if it held everything.
+    struct TermStatistics {
+        int document_count = 0;
+        uint64_t total_document_length = 0; // non-stop words
+        std::map<std::string, size_t, std::less<>> word_document_freqs;
+        std::map<std::string, size_t, std::less<>> prefix_document_freqs; // documents matching any expansion
+
+        void Merge(const TermStatistics& other);
+    };
 
+    // All index containers allocate from resource. It must be thread-safe if
+    // RemoveDocument(std::execution::par, ...) is used, the other methods never
+    // allocate from it concurrently.
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words); // Extract non-empty stop words
-    explicit SearchServer(const std::string& stop_words_text); // Invoke delegating constructor from string container
-    explicit SearchServer(const std::string_view& stop_words_view);
+    explicit SearchServer(const StringContainer& stop_words, std::pmr::memory_resource* resource = std::pmr::get_default_resource()); // Extract non-empty stop words
+    explicit SearchServer(const std::string& stop_words_text, std::pmr::memory_resource* resource = std::pmr::get_default_resource()); // Invoke delegating constructor from string container
+    explicit SearchServer(const std::string_view& stop_words_view, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Must be called before any document is added
+    void EnablePositionalIndex();
+
+    // Query-time temporaries are allocated from the resource provider() returns on the thread
+    // that runs the query. By default that is a thread-local pool, which keeps its peak size
+    // for the life of the thread. Must not be called while queries are running.
+    // Not covered, they still use the global allocator: phrases, NEAR pairs and boolean
+    // clauses of the parsed query, the member lists of bound boolean groups, and the
+    // ConcurrentMap the std::execution::par searches accumulate into, which is filled from
+    // several threads at once and so could not use the default unsynchronized pool.
+    using QueryResourceProvider = std::function<std::pmr::memory_resource*()>;
+    void SetQueryResourceProvider(QueryResourceProvider provider);
 
     void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+    // Indexes the text in place without copying it; storage_owner keeps the memory it points into alive
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings, std::shared_ptr<const void> storage_owner);
+    // Same, with words = SplitIntoWordsNoStop(document) computed by the caller
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings, std::shared_ptr<const void> storage_owner, const std::vector<PositionedWord>& words);
+
+    // The tokenization AddDocument applies. Reads nothing but the stop words, so loaders
+    // may run it on several threads while documents are being added.
+    std::vector<PositionedWord> SplitIntoWordsNoStop(const std::string_view& text) const;
+
+    // Every search method takes a ranking policy from ranking.h as its first template
+    // argument, e.g. FindTopDocuments<Bm25Ranking>(raw_query); TF-IDF by default
 
     // default methods
-    template <typename DocumentPredicate>
+    template <typename Ranking = TfIdfRanking, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const;
+    template <typename Ranking = TfIdfRanking>
     std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const;
+    template <typename Ranking = TfIdfRanking>
     std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
 
+    // Statistics of the query terms held by this server
+    TermStatistics GetTermStatistics(const std::string_view& raw_query) const;
+    // Ranks with the given statistics instead of the local ones
+    template <typename Ranking = TfIdfRanking, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, const TermStatistics& statistics, DocumentPredicate document_predicate) const;
+
     // parallel unsequenced policy methods
-    template <typename DocumentPredicate, typename ExecutionPolicy>
+    template <typename Ranking = TfIdfRanking, typename DocumentPredicate, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy, const std::string_view& raw_query, DocumentPredicate document_predicate) const;
-    template <typename ExecutionPolicy>
+    template <typename Ranking = TfIdfRanking, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy, const std::string_view& raw_query, DocumentStatus status) const;
-    template <typename ExecutionPolicy>
+    template <typename Ranking = TfIdfRanking, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy, const std::string_view& raw_query) const;
 
+    // Pages through the whole ranking: cursor is empty for the first page,
+    // then the next_cursor of the previous page. Only selecting the page is bounded
+    // by page_size, scoring still costs time and memory for every matching document.
+    template <typename Ranking = TfIdfRanking, typename DocumentPredicate>
+    SearchPage FindTopDocumentsPage(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t page_size, const std::string& cursor = {}) const;
+    template <typename Ranking = TfIdfRanking>
+    SearchPage FindTopDocumentsPage(const std::string_view& raw_query, DocumentStatus status, size_t page_size, const std::string& cursor = {}) const;
+    template <typename Ranking = TfIdfRanking>
+    SearchPage FindTopDocumentsPage(const std::string_view& raw_query, size_t page_size, const std::string& cursor = {}) const;
+
+    // Relevance descending in steps of TEN_POWER_MINUS_SIX, then rating descending, then id ascending
+    static bool RanksHigher(const Document& lhs, const Document& rhs);
+
     int GetDocumentCount() const;
 
     tuple_matched_words_and_status MatchDocument(const std::string_view& raw_query, int document_id) const;
     tuple_matched_words_and_status MatchDocument(const std::execution::sequenced_policy&, const std::string_view& raw_query, int document_id) const;
     tuple_matched_words_and_status MatchDocument(const std::execution::parallel_policy&, const std::string_view& raw_query, int document_id) const;
 
-    std::set<int>::const_iterator begin() const;
+    std::pmr::set<int>::const_iterator begin() const;
 
-    std::set<int>::const_iterator end() const;
+    std::pmr::set<int>::const_iterator end() const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(const int document_id) const;
+    const std::pmr::map<std::string_view, double>& GetWordFrequencies(const int document_id) const;
 
+    // Views into the index, they allocate nothing and are invalidated by RemoveDocument.
+    // Terms of the document in lexicographic order:
+    TermRange GetDocumentTerms(int document_id) const;
+    // (document_id, term_freq) pairs of the term in document id order:
+    PostingRange GetTermPostings(std::string_view term) const;
+
+    // Walks the whole index, meant for monitoring rather than for every request
+    MemoryStats GetMemoryStats() const;
+
+    // Unknown ids are ignored by every overload
     void RemoveDocument(const int document_id);
     void RemoveDocument(const std::execution::sequenced_policy&, const int document_id);
     void RemoveDocument(const std::execution::parallel_policy&, const int document_id);
@@ -68,19 +154,30 @@ private:
         int rating;
         DocumentStatus status;
         std::string_view data;
+        uint32_t length; // non-stop words, the length norm of the ranking policies
     };
-    const std::set<std::string> stop_words_;
-    std::deque<std::string> global_storage_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
-
-    bool IsStopWord(const std::string& word) const;
-
-    static bool IsValidWord(const std::string& word);
-
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view& text) const;
+    const std::pmr::set<std::pmr::string, std::less<>> stop_words_;
+    std::pmr::deque<std::pmr::string> global_storage_;
+    std::pmr::vector<std::shared_ptr<const void>> external_storage_;
+    std::pmr::map<std::string_view, std::pmr::map<int, double>> word_to_document_freqs_;
+    std::pmr::map<int, DocumentData> documents_;
+    uint64_t total_document_length_ = 0;
+    std::pmr::set<int> document_ids_;
+    std::pmr::map<int, std::pmr::map<std::string_view, double>> document_to_word_freqs_;
+    bool positional_index_enabled_ = false;
+    PositionalIndex positional_index_;
+    // Snapshot of the non-empty terms plus the terms that became non-empty since it was built.
+    // Terms that became empty stay in the snapshot and are skipped by the expansion.
+    TermDictionary term_dictionary_;
+    std::pmr::set<std::string_view> new_terms_;
+    size_t term_changes_ = 0; // terms added to or emptied out of the index since the snapshot
+    QueryResourceProvider query_resource_provider_;
+
+    bool IsStopWord(std::string_view word) const;
+
+    static bool IsValidWord(std::string_view word);
+
+    void IndexDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings, const std::vector<PositionedWord>& words);
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
@@ -88,49 +185,206 @@ private:
         std::string data;
         bool is_minus;
         bool is_stop;
+        bool is_prefix;
     };
 
     QueryWord ParseQueryWord(const std::string& text) const;
 
+    enum class Occur {
+        MUST,
+        SHOULD,
+        MUST_NOT,
+    };
+
+    // A term or a parenthesized group of a boolean query
+    struct QueryClause {
+        Occur occur = Occur::SHOULD;
+        std::string term; // empty for a group
+        bool is_prefix = false;
+        std::vector<QueryClause> clauses; // members of a group
+    };
+
     struct Query {
-        std::vector<std::string> plus_words;
-        std::vector<std::string> minus_words;
+        explicit Query(std::pmr::memory_resource* resource)
+            : plus_words(resource)
+            , minus_words(resource)
+            , plus_prefixes(resource)
+            , minus_prefixes(resource) {
+        }
+
+        std::pmr::vector<std::pmr::string> plus_words;
+        std::pmr::vector<std::pmr::string> minus_words;
+        std::pmr::vector<std::pmr::string> plus_prefixes;
+        std::pmr::vector<std::pmr::string> minus_prefixes;
+        std::vector<PositionalIndex::Phrase> phrases;
+        std::vector<PositionalIndex::Proximity> proximities;
+        // Required terms and groups; when present the whole query is evaluated as a boolean
+        // group whose other members are the plus words (SHOULD) and minus words (MUST_NOT)
+        std::vector<QueryClause> boolean_clauses;
+        const TermStatistics* statistics = nullptr; // overrides the local document frequencies when set
     };
 
+    // Query-time temporaries never leave the thread that parsed the query
+    static std::pmr::memory_resource* GetThreadQueryPool();
+
+    std::pmr::memory_resource* GetQueryResource() const;
+
+    template <typename StringContainer>
+    static std::pmr::set<std::pmr::string, std::less<>> MakeStopWords(const StringContainer& stop_words, std::pmr::memory_resource* resource);
+
     Query ParseQuery(const std::string_view& text, bool sort_flag = true) const;
 
+    // Parses a quoted phrase starting at words[begin], returns the index past its closing quote.
+    // Its words are taken literally, a quoted single word is how indexed words like (beta) or +1 are searched.
+    size_t ParsePhrase(const std::vector<std::string_view>& words, size_t begin, Query& query) const;
+
+    static bool IsNearOperator(const std::string_view& word, uint32_t& distance);
+
+    // A plain word at tokens[index]: not a required term, group, phrase or another operator
+    static bool IsNearOperand(const std::vector<std::string_view>& tokens, size_t index);
+
+    // Splits group parentheses off the words outside quotes: "+(cat" -> "+(", "cat" and "dog))" -> "dog", ")", ")"
+    static std::vector<std::string_view> SplitIntoQueryTokens(const std::string_view& text);
+
+    static bool IsGroupOpening(const std::string_view& token);
+
+    // A phrase with a '+' or '-' in front, which the parser rejects
+    static bool IsSignedPhrase(const std::string_view& token);
+
+    // Parses the group opened by tokens[begin], returns the index past its closing parenthesis
+    size_t ParseGroup(const std::vector<std::string_view>& tokens, size_t begin, int depth, QueryClause& group) const;
+
+    // A term with an optional '+' or '-' in front, stop words give nothing
+    std::optional<QueryClause> ParseClause(std::string_view token) const;
+
+    // A clause resolved against the index for one query
+    struct BoundClause {
+        explicit BoundClause(std::pmr::memory_resource* resource) : prefix_postings(resource) {}
+
+        Occur occur = Occur::SHOULD;
+        bool is_group = false;
+        const std::pmr::map<int, double>* word_postings = nullptr;
+        std::pmr::vector<std::pair<int, double>> prefix_postings;
+        double inverse_document_freq = 0.0;
+        size_t estimated_size = 0; // no more documents can match the clause
+        std::vector<BoundClause> clauses;
+    };
+
+    template <typename Ranking>
+    BoundClause BindQuery(const Query& query, const Ranking& ranking) const;
+
+    template <typename Ranking>
+    BoundClause BindTerm(Occur occur, std::string_view term, bool is_prefix, const Query& query, const Ranking& ranking) const;
+
+    template <typename Ranking>
+    BoundClause BindClause(const QueryClause& clause, const Query& query, const Ranking& ranking) const;
+
+    static void UpdateGroupEstimate(BoundClause& group);
+
+    // Ordered ids of the documents that may match the clause. A group takes them from its
+    // rarest required member, or from the union of its optional members if none is required.
+    void CollectCandidates(const BoundClause& clause, std::pmr::vector<int>& candidates) const;
+
+    // Relevance of the document, nothing if it does not match the clause
+    template <typename Ranking>
+    std::optional<double> ScoreClause(const BoundClause& clause, int document_id, uint32_t document_length, const Ranking& ranking) const;
+
+    bool MatchesBooleanClauses(const Query& query, int document_id) const;
+
+    // Appends the index terms of non-negated clauses that occur in the document
+    void CollectClauseWords(const std::vector<QueryClause>& clauses, int document_id, std::vector<std::string_view>& matched_words) const;
+
+    void CollectClauseStatistics(const std::vector<QueryClause>& clauses, TermStatistics& statistics) const;
+
+    bool HasMinusPrefixMatch(const Query& query, int document_id) const;
+
+    bool MatchesPositionalConstraints(const Query& query, int document_id) const;
+
+    void ApplyPositionalConstraints(const Query& query, std::pmr::map<int, double>& document_to_relevance) const;
+
+    // Rebuilds the snapshot once enough terms changed, so the cost is spread over the changes
+    void UpdateTermDictionary();
+
+    // Calls callback(term, document_freqs) for at most MAX_PREFIX_EXPANSION terms starting with prefix
+    template <typename Callback>
+    void ForEachPrefixExpansion(std::string_view prefix, Callback callback) const;
+
+    // Union of the expanded postings as (document_id, summed term_freq), ordered by document_id
+    std::pmr::vector<std::pair<int, double>> MergePrefixPostings(std::string_view prefix) const;
+
+    // Built from the query statistics when set, from the local index otherwise
+    template <typename Ranking>
+    Ranking MakeRanking(const Query& query) const;
+
     // Existence required
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    size_t GetWordDocumentFreq(const Query& query, std::string_view word) const;
+
+    size_t GetPrefixDocumentFreq(const Query& query, std::string_view prefix, size_t local_document_freq) const;
 
-    template <typename DocumentPredicate>
+    template <typename Ranking, typename DocumentPredicate>
     std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
 
-    template <typename DocumentPredicate, typename ExecutionPolicy>
+    template <typename Ranking, typename DocumentPredicate, typename ExecutionPolicy>
     std::vector<Document> FindAllDocuments(ExecutionPolicy, const Query& query, DocumentPredicate document_predicate) const;
+
+    template <typename Ranking, typename DocumentPredicate, typename ExecutionPolicy>
+    std::vector<Document> FindAllBooleanDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate) const;
 };
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words) : stop_words_(MakeUniqueNonEmptyStrings(stop_words))  // Extract non-empty stop words
+SearchServer::SearchServer(const StringContainer& stop_words, std::pmr::memory_resource* resource)
+    : stop_words_(MakeStopWords(stop_words, resource))  // Extract non-empty stop words
+    , global_storage_(resource)
+    , external_storage_(resource)
+    , word_to_document_freqs_(resource)
+    , documents_(resource)
+    , document_ids_(resource)
+    , document_to_word_freqs_(resource)
+    , positional_index_(resource)
+    , new_terms_(resource)
+    , query_resource_provider_(GetThreadQueryPool)
 {
     if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
         throw std::invalid_argument("Some of stop words are invalid"s);
     }
 }
 
-template <typename DocumentPredicate>
+template <typename Ranking, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const {
     const auto query = ParseQuery(raw_query);
     
-    auto matched_documents = FindAllDocuments(query, document_predicate);
+    auto matched_documents = FindAllDocuments<Ranking>(query, document_predicate);
+
+    std::sort(matched_documents.begin(), matched_documents.end(), RanksHigher);
+
+    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+
+    return matched_documents;
+}
 
-    std::sort(matched_documents.begin(), matched_documents.end(),
-            [](const Document& lhs, const Document& rhs) {
-                if (std::abs(lhs.relevance - rhs.relevance) < TEN_POWER_MINUS_SIX) {
-                    return lhs.rating > rhs.rating;
-                } else {
-                    return lhs.relevance > rhs.relevance;
-                }
-            });
+template <typename Ranking>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const {
+    return FindTopDocuments<Ranking>(
+        raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        });
+}
+
+template <typename Ranking>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query) const {
+    return FindTopDocuments<Ranking>(raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename Ranking, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, const TermStatistics& statistics, DocumentPredicate document_predicate) const {
+    auto query = ParseQuery(raw_query);
+    query.statistics = &statistics;
+
+    auto matched_documents = FindAllDocuments<Ranking>(query, document_predicate);
+
+    std::sort(matched_documents.begin(), matched_documents.end(), RanksHigher);
 
     if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
         matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
@@ -139,23 +393,70 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw
     return matched_documents;
 }
 
-template <typename DocumentPredicate, typename ExecutionPolicy>
+template <typename Ranking, typename DocumentPredicate>
+SearchPage SearchServer::FindTopDocumentsPage(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t page_size, const std::string& cursor) const {
+    if (page_size == 0) {
+        throw std::invalid_argument("Page size must be positive"s);
+    }
+    const bool has_cursor = !cursor.empty();
+    const Document last_seen = has_cursor ? DecodePageCursor(cursor) : Document();
+
+    const auto query = ParseQuery(raw_query);
+
+    // Keeps one extra document to learn whether another page exists; the top is the lowest ranked one
+    std::priority_queue<Document, std::vector<Document>, decltype(&RanksHigher)> page(RanksHigher);
+    for (const Document& document : FindAllDocuments<Ranking>(query, document_predicate)) {
+        if (has_cursor && !RanksHigher(last_seen, document)) {
+            continue;
+        }
+        if (page.size() <= page_size) {
+            page.push(document);
+        } else if (RanksHigher(document, page.top())) {
+            page.pop();
+            page.push(document);
+        }
+    }
+
+    const bool has_next_page = page.size() > page_size;
+    if (has_next_page) {
+        page.pop();
+    }
+
+    SearchPage result;
+    result.documents.resize(page.size());
+    for (auto it = result.documents.rbegin(); it != result.documents.rend(); ++it) {
+        *it = page.top();
+        page.pop();
+    }
+    if (has_next_page) {
+        result.next_cursor = EncodePageCursor(result.documents.back());
+    }
+    return result;
+}
+
+template <typename Ranking>
+SearchPage SearchServer::FindTopDocumentsPage(const std::string_view& raw_query, DocumentStatus status, size_t page_size, const std::string& cursor) const {
+    return FindTopDocumentsPage<Ranking>(
+        raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        }, page_size, cursor);
+}
+
+template <typename Ranking>
+SearchPage SearchServer::FindTopDocumentsPage(const std::string_view& raw_query, size_t page_size, const std::string& cursor) const {
+    return FindTopDocumentsPage<Ranking>(raw_query, DocumentStatus::ACTUAL, page_size, cursor);
+}
+
+template <typename Ranking, typename DocumentPredicate, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy, const std::string_view& raw_query, DocumentPredicate document_predicate) const {
     if (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
-        return FindTopDocuments(raw_query, document_predicate);
+        return FindTopDocuments<Ranking>(raw_query, document_predicate);
     }
     const auto query = ParseQuery(raw_query);
     
-    auto matched_documents = FindAllDocuments(std::execution::par, query, document_predicate);
+    auto matched_documents = FindAllDocuments<Ranking>(std::execution::par, query, document_predicate);
 
-    std::sort(matched_documents.begin(), matched_documents.end(),
-            [](const Document& lhs, const Document& rhs) {
-                if (std::abs(lhs.relevance - rhs.relevance) < TEN_POWER_MINUS_SIX) {
-                    return lhs.rating > rhs.rating;
-                } else {
-                    return lhs.relevance > rhs.relevance;
-                }
-            });
+    std::sort(matched_documents.begin(), matched_documents.end(), RanksHigher);
 
     if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
         matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
@@ -164,35 +465,101 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy, const std:
     return matched_documents;
 }
 
-template <typename ExecutionPolicy>
+template <typename Ranking, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, const std::string_view& raw_query, DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+    return FindTopDocuments<Ranking>(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
         return document_status == status;
     });
 }
 
-template <typename ExecutionPolicy>
+template <typename Ranking, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, const std::string_view& raw_query) const {
-    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+    return FindTopDocuments<Ranking>(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename StringContainer>
+std::pmr::set<std::pmr::string, std::less<>> SearchServer::MakeStopWords(const StringContainer& stop_words, std::pmr::memory_resource* resource) {
+    std::pmr::set<std::pmr::string, std::less<>> dst(resource);
+    for (const std::string& word : MakeUniqueNonEmptyStrings(stop_words)) {
+        dst.emplace(word);
+    }
+    return dst;
+}
+
+template <typename Callback>
+void SearchServer::ForEachPrefixExpansion(std::string_view prefix, Callback callback) const {
+    size_t expanded = 0;
+    const auto expand = [this, &callback, &expanded](std::string_view term) {
+        const auto it = word_to_document_freqs_.find(term);
+        if (it != word_to_document_freqs_.end() && !it->second.empty()) {
+            callback(it->first, it->second);
+            ++expanded;
+        }
+        return expanded < MAX_PREFIX_EXPANSION;
+    };
+
+    // Merges the new terms into the snapshot scan, so the expansion stays in lexicographic order
+    auto new_term = new_terms_.lower_bound(prefix);
+    bool go_on = true;
+    term_dictionary_.ForEachWithPrefix(prefix, [this, &expand, &new_term, &go_on](std::string_view term) {
+        for (; new_term != new_terms_.end() && *new_term < term; ++new_term) {
+            if (!expand(*new_term)) {
+                return go_on = false;
+            }
+        }
+        if (new_term != new_terms_.end() && *new_term == term) {
+            ++new_term;
+        }
+        return go_on = expand(term);
+    });
+    for (; go_on && new_term != new_terms_.end() && new_term->substr(0, prefix.size()) == prefix; ++new_term) {
+        go_on = expand(*new_term);
+    }
 }
 
-template <typename DocumentPredicate>
+template <typename Ranking>
+Ranking SearchServer::MakeRanking(const Query& query) const {
+    const int document_count = query.statistics != nullptr ? query.statistics->document_count : GetDocumentCount();
+    const uint64_t total_document_length = query.statistics != nullptr ? query.statistics->total_document_length : total_document_length_;
+    return Ranking(document_count, document_count > 0 ? total_document_length * 1.0 / document_count : 0.0);
+}
+
+template <typename Ranking, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (const std::string& word : query.plus_words) {
+    if (!query.boolean_clauses.empty()) {
+        return FindAllBooleanDocuments<Ranking>(std::execution::seq, query, document_predicate);
+    }
+
+    const Ranking ranking = MakeRanking<Ranking>(query);
+    std::pmr::map<int, double> document_to_relevance(GetQueryResource());
+    for (const auto& word : query.plus_words) {
         if (word_to_document_freqs_.count(word) == 0) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+        const double inverse_document_freq = ranking.ComputeInverseDocumentFreq(GetWordDocumentFreq(query, word));
         for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
             const auto& document_data = documents_.at(document_id);
             if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                document_to_relevance[document_id] += ranking.ComputeScore(term_freq, inverse_document_freq, document_data.length);
             }
         }
     }
 
-    for (const std::string& word : query.minus_words) {
+    for (const auto& prefix : query.plus_prefixes) {
+        const auto postings = MergePrefixPostings(prefix);
+        if (postings.empty()) {
+            continue;
+        }
+        const double inverse_document_freq = ranking.ComputeInverseDocumentFreq(GetPrefixDocumentFreq(query, prefix, postings.size()));
+        for (const auto& [document_id, term_freq] : postings) {
+            const auto& document_data = documents_.at(document_id);
+            if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                document_to_relevance[document_id] += ranking.ComputeScore(term_freq, inverse_document_freq, document_data.length);
+            }
+        }
+    }
+
+    for (const auto& word : query.minus_words) {
         if (word_to_document_freqs_.count(word) == 0) {
             continue;
         }
@@ -201,6 +568,16 @@ std::vector<Document> SearchServer::FindAllDocuments(const Query& query, Documen
         }
     }
 
+    for (const auto& prefix : query.minus_prefixes) {
+        ForEachPrefixExpansion(prefix, [&document_to_relevance](std::string_view, const auto& document_freqs) {
+            for (const auto [document_id, _] : document_freqs) {
+                document_to_relevance.erase(document_id);
+            }
+        });
+    }
+
+    ApplyPositionalConstraints(query, document_to_relevance);
+
     std::vector<Document> matched_documents;
     for (const auto [document_id, relevance] : document_to_relevance) {
         matched_documents.push_back(
@@ -209,23 +586,42 @@ std::vector<Document> SearchServer::FindAllDocuments(const Query& query, Documen
     return matched_documents;
 }
 
-template <typename DocumentPredicate, typename ExecutionPolicy>
+template <typename Ranking, typename DocumentPredicate, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy, const Query& query, DocumentPredicate document_predicate) const {
     if (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
-        return FindAllDocuments(query, document_predicate);
+        return FindAllDocuments<Ranking>(query, document_predicate);
+    }
+    if (!query.boolean_clauses.empty()) {
+        return FindAllBooleanDocuments<Ranking>(std::execution::par, query, document_predicate);
     }
 
+    const Ranking ranking = MakeRanking<Ranking>(query);
+
     ConcurrentMap<int, double> document_to_relevance(100);
 
-    for_each(std::execution::par, query.plus_words.begin(), query.plus_words.end(), [this, &document_predicate, &document_to_relevance](const auto& word) {
+    for_each(std::execution::par, query.plus_words.begin(), query.plus_words.end(), [this, &query, &ranking, &document_predicate, &document_to_relevance](const auto& word) {
         if (word_to_document_freqs_.count(word) == 0) {
             return;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+        const double inverse_document_freq = ranking.ComputeInverseDocumentFreq(GetWordDocumentFreq(query, word));
         for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
             const auto& document_data = documents_.at(document_id);
             if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                document_to_relevance[document_id] += ranking.ComputeScore(term_freq, inverse_document_freq, document_data.length);
+            }
+        }
+    });
+
+    for_each(std::execution::par, query.plus_prefixes.begin(), query.plus_prefixes.end(), [this, &query, &ranking, &document_predicate, &document_to_relevance](const auto& prefix) {
+        const auto postings = MergePrefixPostings(prefix);
+        if (postings.empty()) {
+            return;
+        }
+        const double inverse_document_freq = ranking.ComputeInverseDocumentFreq(GetPrefixDocumentFreq(query, prefix, postings.size()));
+        for (const auto& [document_id, term_freq] : postings) {
+            const auto& document_data = documents_.at(document_id);
+            if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                document_to_relevance[document_id] += ranking.ComputeScore(term_freq, inverse_document_freq, document_data.length);
             }
         }
     });
@@ -239,10 +635,159 @@ std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy, const Quer
         }
     });
 
+    for_each(std::execution::par, query.minus_prefixes.begin(), query.minus_prefixes.end(), [this, &document_to_relevance](const auto& prefix) {
+        ForEachPrefixExpansion(prefix, [&document_to_relevance](std::string_view, const auto& document_freqs) {
+            for (const auto [document_id, _] : document_freqs) {
+                document_to_relevance.Erase(document_id);
+            }
+        });
+    });
+
+    auto ordinary_document_to_relevance = document_to_relevance.BuildOrdinaryMap();
+    ApplyPositionalConstraints(query, ordinary_document_to_relevance);
+
+    std::vector<Document> matched_documents;
+    for (const auto [document_id, relevance] : ordinary_document_to_relevance) {
+        matched_documents.push_back(
+            {document_id, relevance, documents_.at(document_id).rating});
+    }
+    return matched_documents;
+}
+
+template <typename Ranking>
+SearchServer::BoundClause SearchServer::BindQuery(const Query& query, const Ranking& ranking) const {
+    BoundClause root(GetQueryResource());
+    root.is_group = true;
+    for (const auto& word : query.plus_words) {
+        root.clauses.push_back(BindTerm(Occur::SHOULD, word, false, query, ranking));
+    }
+    for (const auto& prefix : query.plus_prefixes) {
+        root.clauses.push_back(BindTerm(Occur::SHOULD, prefix, true, query, ranking));
+    }
+    for (const auto& word : query.minus_words) {
+        root.clauses.push_back(BindTerm(Occur::MUST_NOT, word, false, query, ranking));
+    }
+    for (const auto& prefix : query.minus_prefixes) {
+        root.clauses.push_back(BindTerm(Occur::MUST_NOT, prefix, true, query, ranking));
+    }
+    for (const QueryClause& clause : query.boolean_clauses) {
+        root.clauses.push_back(BindClause(clause, query, ranking));
+    }
+    UpdateGroupEstimate(root);
+    return root;
+}
+
+template <typename Ranking>
+SearchServer::BoundClause SearchServer::BindTerm(Occur occur, std::string_view term, bool is_prefix, const Query& query, const Ranking& ranking) const {
+    BoundClause bound(GetQueryResource());
+    bound.occur = occur;
+    if (is_prefix) {
+        bound.prefix_postings = MergePrefixPostings(term);
+        bound.estimated_size = bound.prefix_postings.size();
+        if (bound.estimated_size > 0) {
+            bound.inverse_document_freq = ranking.ComputeInverseDocumentFreq(GetPrefixDocumentFreq(query, term, bound.estimated_size));
+        }
+    } else if (const auto it = word_to_document_freqs_.find(term); it != word_to_document_freqs_.end() && !it->second.empty()) {
+        bound.word_postings = &it->second;
+        bound.estimated_size = it->second.size();
+        bound.inverse_document_freq = ranking.ComputeInverseDocumentFreq(GetWordDocumentFreq(query, term));
+    }
+    return bound;
+}
+
+template <typename Ranking>
+SearchServer::BoundClause SearchServer::BindClause(const QueryClause& clause, const Query& query, const Ranking& ranking) const {
+    if (!clause.term.empty()) {
+        return BindTerm(clause.occur, clause.term, clause.is_prefix, query, ranking);
+    }
+    BoundClause group(GetQueryResource());
+    group.occur = clause.occur;
+    group.is_group = true;
+    for (const QueryClause& member : clause.clauses) {
+        group.clauses.push_back(BindClause(member, query, ranking));
+    }
+    UpdateGroupEstimate(group);
+    return group;
+}
+
+template <typename Ranking>
+std::optional<double> SearchServer::ScoreClause(const BoundClause& clause, int document_id, uint32_t document_length, const Ranking& ranking) const {
+    if (clause.word_postings != nullptr) {
+        const auto it = clause.word_postings->find(document_id);
+        if (it == clause.word_postings->end()) {
+            return std::nullopt;
+        }
+        return ranking.ComputeScore(it->second, clause.inverse_document_freq, document_length);
+    }
+
+    if (!clause.is_group) {
+        const auto it = std::lower_bound(clause.prefix_postings.begin(), clause.prefix_postings.end(), document_id, [](const auto& posting, int id) {
+            return posting.first < id;
+        });
+        if (it == clause.prefix_postings.end() || it->first != document_id) {
+            return std::nullopt;
+        }
+        return ranking.ComputeScore(it->second, clause.inverse_document_freq, document_length);
+    }
+
+    // Lucene semantics: every MUST member, no MUST_NOT member, and at least one SHOULD member
+    // when nothing is required; the relevance is the sum over the matching members
+    double relevance = 0.0;
+    bool has_required = false;
+    bool matched_optional = false;
+    for (const BoundClause& member : clause.clauses) {
+        const auto member_relevance = ScoreClause(member, document_id, document_length, ranking);
+        if (member.occur == Occur::MUST) {
+            if (!member_relevance) {
+                return std::nullopt;
+            }
+            relevance += *member_relevance;
+            has_required = true;
+        } else if (member.occur == Occur::MUST_NOT) {
+            if (member_relevance) {
+                return std::nullopt;
+            }
+        } else if (member_relevance) {
+            relevance += *member_relevance;
+            matched_optional = true;
+        }
+    }
+    if (!has_required && !matched_optional) {
+        return std::nullopt;
+    }
+    return relevance;
+}
+
+template <typename Ranking, typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindAllBooleanDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate) const {
+    const Ranking ranking = MakeRanking<Ranking>(query);
+    const BoundClause root = BindQuery(query, ranking);
+
+    // Only the candidates of the rarest required clause are visited, every other clause is probed
+    std::pmr::vector<int> candidates(GetQueryResource());
+    CollectCandidates(root, candidates);
+
+    std::vector<std::optional<double>> relevances(candidates.size());
+    std::transform(policy, candidates.begin(), candidates.end(), relevances.begin(), [this, &root, &ranking, &document_predicate](int document_id) {
+        const auto& document_data = documents_.at(document_id);
+        if (!document_predicate(document_id, document_data.status, document_data.rating)) {
+            return std::optional<double>();
+        }
+        return ScoreClause(root, document_id, document_data.length, ranking);
+    });
+
+    std::pmr::map<int, double> document_to_relevance(GetQueryResource());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (relevances[i]) {
+            document_to_relevance.emplace_hint(document_to_relevance.end(), candidates[i], *relevances[i]);
+        }
+    }
+    ApplyPositionalConstraints(query, document_to_relevance);
+
     std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
+    for (const auto [document_id, relevance] : document_to_relevance) {
         matched_documents.push_back(
             {document_id, relevance, documents_.at(document_id).rating});
     }
     return matched_documents;
-}
\ No newline at end of file
+}
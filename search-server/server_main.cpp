@@ -0,0 +1,78 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+
+#include "corpus_loader.h"
+#include "network_server.h"
+#include "search_server.h"
+
+using namespace std;
+
+namespace {
+
+NetworkServer* running_server = nullptr;
+
+void HandleSignal(int) {
+    if (running_server != nullptr) {
+        running_server->Stop();
+    }
+}
+
+void PrintUsage() {
+    cerr << "Usage: search_server_daemon (--unix PATH | --port PORT) [--stop-words \"WORDS\"] [--positional] [--batch SIZE] [--max-output BYTES] [--corpus FILE]"s << endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    NetworkServerOptions options;
+    string stop_words;
+    bool positional = false;
+    string corpus_path;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--unix"s && has_value) {
+            options.unix_socket_path = argv[++i];
+        } else if (arg == "--port"s && has_value) {
+            options.tcp_port = static_cast<uint16_t>(stoi(argv[++i]));
+        } else if (arg == "--stop-words"s && has_value) {
+            stop_words = argv[++i];
+        } else if (arg == "--batch"s && has_value) {
+            options.max_batch_size = stoul(argv[++i]);
+        } else if (arg == "--max-output"s && has_value) {
+            options.max_output_size = stoul(argv[++i]);
+        } else if (arg == "--corpus"s && has_value) {
+            corpus_path = argv[++i];
+        } else if (arg == "--positional"s) {
+            positional = true;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (options.unix_socket_path.empty() && options.tcp_port == 0) {
+        PrintUsage();
+        return 1;
+    }
+
+    try {
+        SearchServer search_server(stop_words);
+        if (positional) {
+            search_server.EnablePositionalIndex();
+        }
+        if (!corpus_path.empty()) {
+            cerr << "Loaded "s << LoadCorpus(search_server, corpus_path) << " documents"s << endl;
+        }
+        NetworkServer server(search_server, options);
+        running_server = &server;
+        signal(SIGINT, HandleSignal);
+        signal(SIGTERM, HandleSignal);
+        server.Run();
+        running_server = nullptr;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include "sharded_search_server.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <memory_resource>
+#include <optional>
+
+using namespace std;
+
+namespace {
+
+// Parses a kernel cpulist such as "0-3,8,10-11"
+vector<int> ParseCpuList(const string& text) {
+    vector<int> cpus;
+    size_t begin = 0;
+    while (begin < text.size()) {
+        const size_t end = min(text.find(',', begin), text.size());
+        const string range = text.substr(begin, end - begin);
+        const size_t dash = range.find('-');
+        const int first = stoi(range.substr(0, dash));
+        const int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+        begin = end + 1;
+    }
+    return cpus;
+}
+
+// CPUs of every NUMA node with CPUs, empty if the kernel does not expose the topology
+vector<vector<int>> ReadNumaNodeCpus() {
+    vector<vector<int>> nodes;
+    for (int node = 0;; ++node) {
+        ifstream input("/sys/devices/system/node/node"s + to_string(node) + "/cpulist"s);
+        if (!input) {
+            break;
+        }
+        string text;
+        getline(input, text);
+        vector<int> cpus = ParseCpuList(text);
+        if (!cpus.empty()) {
+            nodes.push_back(move(cpus));
+        }
+    }
+    return nodes;
+}
+
+// CPUs the calling thread may run on, as restricted by a cpuset or taskset
+vector<int> ReadAllowedCpus() {
+    vector<int> cpus;
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cpu_set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    if (cpus.empty()) {
+        const int core_count = max(1u, thread::hardware_concurrency());
+        for (int cpu = 0; cpu < core_count; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+void PinCurrentThread(const vector<int>& cpus) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (const int cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpu_set);
+        }
+    }
+    // Placement is an optimization only, a restricted affinity mask is not an error
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+}
+
+}
+
+ShardedSearchServer::ShardedSearchServer(const string& stop_words_text, size_t shard_count)
+    : ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count) {
+}
+
+void ShardedSearchServer::CreateShards(const vector<string>& stop_words, size_t shard_count) {
+    if (shard_count == 0) {
+        throw invalid_argument("Shard count must be positive"s);
+    }
+
+    // Shards are spread round-robin over the NUMA nodes, or over single cores without them,
+    // using only the CPUs this process was given
+    const vector<int> allowed_cpus = ReadAllowedCpus();
+    vector<vector<int>> cpu_sets;
+    for (vector<int>& node_cpus : ReadNumaNodeCpus()) {
+        node_cpus.erase(remove_if(node_cpus.begin(), node_cpus.end(), [&allowed_cpus](int cpu) {
+            return !binary_search(allowed_cpus.begin(), allowed_cpus.end(), cpu);
+        }), node_cpus.end());
+        if (!node_cpus.empty()) {
+            cpu_sets.push_back(move(node_cpus));
+        }
+    }
+    if (cpu_sets.size() <= 1) {
+        cpu_sets.clear();
+        for (const int cpu : allowed_cpus) {
+            cpu_sets.push_back({cpu});
+        }
+    }
+
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(make_unique<Shard>(stop_words, cpu_sets[i % cpu_sets.size()]));
+    }
+}
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    // The text is copied into the shard's own storage on the worker thread
+    GetShard(document_id).Submit([&](SearchServer& search_server) {
+        search_server.AddDocument(document_id, document, status, ratings);
+    }).get();
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    GetShard(document_id).Submit([document_id](SearchServer& search_server) {
+        search_server.RemoveDocument(document_id);
+    }).get();
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    vector<future<int>> counts;
+    for (const auto& shard : shards_) {
+        counts.push_back(shard->Submit([](const SearchServer& search_server) {
+            return search_server.GetDocumentCount();
+        }));
+    }
+    int document_count = 0;
+    for (const int count : GatherAll(counts)) {
+        document_count += count;
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+ShardedSearchServer::Shard& ShardedSearchServer::GetShard(int document_id) const {
+    // Fibonacci hashing spreads consecutive ids evenly
+    const uint64_t hash = static_cast<uint32_t>(document_id) * 0x9E3779B97F4A7C15ull;
+    return *shards_[(hash >> 32) % shards_.size()];
+}
+
+ShardedSearchServer::Shard::Shard(const vector<string>& stop_words, const vector<int>& cpus) {
+    promise<void> started;
+    worker_ = thread([this, &stop_words, &cpus, &started]() {
+        Run(stop_words, cpus, started);
+    });
+    try {
+        started.get_future().get();
+    } catch (...) {
+        worker_.join();
+        throw;
+    }
+}
+
+ShardedSearchServer::Shard::~Shard() {
+    {
+        lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    tasks_ready_.notify_one();
+    worker_.join();
+}
+
+void ShardedSearchServer::Shard::Push(function<void(SearchServer&)> task) {
+    {
+        lock_guard guard(mutex_);
+        tasks_.push_back(move(task));
+    }
+    tasks_ready_.notify_one();
+}
+
+void ShardedSearchServer::Shard::Run(const vector<string>& stop_words, const vector<int>& cpus, promise<void>& started) {
+    PinCurrentThread(cpus);
+
+    // Only this thread allocates from the resource, and it is pinned before the first allocation
+    pmr::unsynchronized_pool_resource resource;
+    optional<SearchServer> search_server;
+    try {
+        const vector<string_view> stop_word_views(stop_words.begin(), stop_words.end());
+        search_server.emplace(stop_word_views, &resource);
+    } catch (...) {
+        started.set_exception(current_exception());
+        return;
+    }
+    started.set_value();
+
+    while (true) {
+        function<void(SearchServer&)> task;
+        {
+            unique_lock lock(mutex_);
+            tasks_ready_.wait(lock, [this]() {
+                return stopping_ || !tasks_.empty();
+            });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task(*search_server);
+    }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+// Documents are hash-partitioned by id across several SearchServer shards.
+// Each shard lives on its own worker thread, pinned to a NUMA node (or to one core
+// when the machine reports no nodes). The shard and its memory resource are created
+// on that thread and only ever touched there, so the index pages are first-touched
+// on the node that serves them and the shard needs no locking.
+class ShardedSearchServer {
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(const StringContainer& stop_words, size_t shard_count);
+    ShardedSearchServer(const std::string& stop_words_text, size_t shard_count);
+
+    ShardedSearchServer(const ShardedSearchServer&) = delete;
+    ShardedSearchServer& operator=(const ShardedSearchServer&) = delete;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    // Shards rank with the term statistics of the whole collection, so the merged
+    // result is the one a single SearchServer holding every document would return.
+    // The exception is a prefix with more than MAX_PREFIX_EXPANSION terms: each shard
+    // expands its own first terms.
+    template <typename Ranking = TfIdfRanking, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const;
+    template <typename Ranking = TfIdfRanking>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const;
+    template <typename Ranking = TfIdfRanking>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetShardCount() const;
+
+private:
+    class Shard {
+    public:
+        Shard(const std::vector<std::string>& stop_words, const std::vector<int>& cpus);
+        ~Shard();
+
+        // Runs function(search_server) on the shard's worker thread
+        template <typename Function>
+        auto Submit(Function function) -> std::future<decltype(function(std::declval<SearchServer&>()))>;
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable tasks_ready_;
+        std::deque<std::function<void(SearchServer&)>> tasks_;
+        bool stopping_ = false;
+        std::thread worker_;
+
+        void Run(const std::vector<std::string>& stop_words, const std::vector<int>& cpus, std::promise<void>& started);
+        void Push(std::function<void(SearchServer&)> task);
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    void CreateShards(const std::vector<std::string>& stop_words, size_t shard_count);
+
+    Shard& GetShard(int document_id) const;
+
+    // Waits for every future before reading any, so no task outlives the arguments it references
+    template <typename Result>
+    static std::vector<Result> GatherAll(std::vector<std::future<Result>>& futures);
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(const StringContainer& stop_words, size_t shard_count) {
+    const std::vector<std::string> words(stop_words.begin(), stop_words.end());
+    CreateShards(words, shard_count);
+}
+
+template <typename Ranking, typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const {
+    const std::string query(raw_query);
+
+    // Scatter twice: first for the collection-wide document frequencies, then for the ranking
+    std::vector<std::future<SearchServer::TermStatistics>> shard_statistics;
+    for (const auto& shard : shards_) {
+        shard_statistics.push_back(shard->Submit([&query](const SearchServer& search_server) {
+            return search_server.GetTermStatistics(query);
+        }));
+    }
+    SearchServer::TermStatistics statistics;
+    for (const auto& partial_statistics : GatherAll(shard_statistics)) {
+        statistics.Merge(partial_statistics);
+    }
+
+    std::vector<std::future<std::vector<Document>>> shard_documents;
+    for (const auto& shard : shards_) {
+        shard_documents.push_back(shard->Submit([&query, &statistics, document_predicate](const SearchServer& search_server) {
+            return search_server.FindTopDocuments<Ranking>(query, statistics, document_predicate);
+        }));
+    }
+
+    // Every shard returns its own top documents, the global top is among them
+    std::vector<Document> matched_documents;
+    for (const auto& documents : GatherAll(shard_documents)) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    std::sort(matched_documents.begin(), matched_documents.end(), SearchServer::RanksHigher);
+    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return matched_documents;
+}
+
+template <typename Ranking>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const {
+    return FindTopDocuments<Ranking>(
+        raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        });
+}
+
+template <typename Ranking>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view& raw_query) const {
+    return FindTopDocuments<Ranking>(raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename Function>
+auto ShardedSearchServer::Shard::Submit(Function function) -> std::future<decltype(function(std::declval<SearchServer&>()))> {
+    using Result = decltype(function(std::declval<SearchServer&>()));
+    auto task = std::make_shared<std::packaged_task<Result(SearchServer&)>>(std::move(function));
+    auto result = task->get_future();
+    Push([task](SearchServer& search_server) {
+        (*task)(search_server);
+    });
+    return result;
+}
+
+template <typename Result>
+std::vector<Result> ShardedSearchServer::GatherAll(std::vector<std::future<Result>>& futures) {
+    for (auto& future : futures) {
+        future.wait();
+    }
+    std::vector<Result> results;
+    results.reserve(futures.size());
+    for (auto& future : futures) {
+        results.push_back(future.get());
+    }
+    return results;
+}
@@ -0,0 +1,76 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+TermDictionary::TermDictionary(const vector<string_view>& sorted_terms) : size_(sorted_terms.size()) {
+    string_view previous;
+    for (size_t i = 0; i < sorted_terms.size(); ++i) {
+        const string_view term = sorted_terms[i];
+        if (i % BLOCK_SIZE == 0) {
+            block_offsets_.push_back(data_.size());
+            WriteVarint(term.size());
+            data_.insert(data_.end(), term.begin(), term.end());
+        } else {
+            const size_t shared = mismatch(previous.begin(), previous.end(), term.begin(), term.end()).first - previous.begin();
+            WriteVarint(shared);
+            WriteVarint(term.size() - shared);
+            data_.insert(data_.end(), term.begin() + shared, term.end());
+        }
+        previous = term;
+    }
+    data_.shrink_to_fit();
+}
+
+size_t TermDictionary::Size() const {
+    return size_;
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+    return data_.capacity() + block_offsets_.capacity() * sizeof(size_t);
+}
+
+void TermDictionary::WriteVarint(size_t value) {
+    while (value >= 0x80) {
+        data_.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    data_.push_back(static_cast<char>(value));
+}
+
+size_t TermDictionary::ReadVarint(size_t& offset) const {
+    size_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = static_cast<uint8_t>(data_[offset++]);
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+string_view TermDictionary::ReadBlockHead(size_t block, size_t& offset) const {
+    offset = block_offsets_[block];
+    const size_t head_size = ReadVarint(offset);
+    const string_view head(data_.data() + offset, head_size);
+    offset += head_size;
+    return head;
+}
+
+size_t TermDictionary::FindBlock(string_view lower) const {
+    size_t left = 0;
+    size_t right = block_offsets_.size();
+    while (right - left > 1) {
+        const size_t middle = (left + right) / 2;
+        size_t offset = 0;
+        if (ReadBlockHead(middle, offset) <= lower) {
+            left = middle;
+        } else {
+            right = middle;
+        }
+    }
+    return left;
+}
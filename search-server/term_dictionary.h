@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Immutable sorted set of terms, front-coded in blocks of BLOCK_SIZE terms:
+// the first term of a block is stored whole, the others as the length of the
+// prefix shared with the previous term followed by the remaining suffix.
+class TermDictionary {
+public:
+    TermDictionary() = default;
+
+    explicit TermDictionary(const std::vector<std::string_view>& sorted_terms);
+
+    size_t Size() const;
+
+    size_t GetMemoryUsage() const; // bytes allocated for the encoded terms
+
+    // Calls callback(term) for the terms in [lower, upper) until it returns false
+    template <typename Callback>
+    void ForEachInRange(std::string_view lower, std::string_view upper, Callback callback) const;
+
+    template <typename Callback>
+    void ForEachWithPrefix(std::string_view prefix, Callback callback) const;
+
+private:
+    static const size_t BLOCK_SIZE = 16;
+
+    std::vector<char> data_;
+    std::vector<size_t> block_offsets_;
+    size_t size_ = 0;
+
+    void WriteVarint(size_t value);
+    size_t ReadVarint(size_t& offset) const;
+    std::string_view ReadBlockHead(size_t block, size_t& offset) const;
+    size_t FindBlock(std::string_view lower) const; // the last block whose head is not greater than lower
+
+    // Decodes terms starting from lower, callback decides whether to go on
+    template <typename Callback>
+    void ScanFrom(std::string_view lower, Callback callback) const;
+};
+
+template <typename Callback>
+void TermDictionary::ForEachInRange(std::string_view lower, std::string_view upper, Callback callback) const {
+    ScanFrom(lower, [upper, &callback](std::string_view term) {
+        return term < upper && callback(term);
+    });
+}
+
+template <typename Callback>
+void TermDictionary::ForEachWithPrefix(std::string_view prefix, Callback callback) const {
+    ScanFrom(prefix, [prefix, &callback](std::string_view term) {
+        return term.substr(0, prefix.size()) == prefix && callback(term);
+    });
+}
+
+template <typename Callback>
+void TermDictionary::ScanFrom(std::string_view lower, Callback callback) const {
+    if (size_ == 0) {
+        return;
+    }
+
+    std::string term;
+    for (size_t block = FindBlock(lower); block < block_offsets_.size(); ++block) {
+        size_t offset = 0;
+        term = ReadBlockHead(block, offset);
+        const size_t block_end = block + 1 < block_offsets_.size() ? block_offsets_[block + 1] : data_.size();
+        while (true) {
+            if (term >= lower && !callback(std::string_view(term))) {
+                return;
+            }
+            if (offset == block_end) {
+                break;
+            }
+            const size_t shared = ReadVarint(offset);
+            const size_t suffix_size = ReadVarint(offset);
+            term.resize(shared);
+            term.append(data_.data() + offset, suffix_size);
+            offset += suffix_size;
+        }
+    }
+}
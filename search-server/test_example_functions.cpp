@@ -0,0 +1,740 @@
+#include "test_example_functions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "corpus_loader.h"
+#include "positional_index.h"
+#include "request_queue.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+
+using namespace std;
+
+namespace {
+
+const string STOP_WORD = "and"s;
+const int DOCUMENT_COUNT = 3000;
+const int QUERY_COUNT = 300;
+
+void Check(bool condition, const string& message) {
+    if (!condition) {
+        throw logic_error(message);
+    }
+}
+
+enum class Occur {
+    MUST,
+    SHOULD,
+    MUST_NOT,
+};
+
+// A term or a group of the generated query, evaluated independently of SearchServer
+struct QueryNode {
+    Occur occur = Occur::SHOULD;
+    string term; // empty for a group
+    bool is_prefix = false;
+    vector<QueryNode> members;
+};
+
+struct Corpus {
+    vector<string> vocabulary;
+    vector<vector<string>> documents; // non-stop words
+    vector<string> texts;
+    vector<int> ratings;
+};
+
+Corpus MakeCorpus(mt19937& generator) {
+    Corpus corpus;
+    for (const string& stem : {"a"s, "ba"s, "bb"s, "c"s}) {
+        for (int i = 0; i < 8; ++i) {
+            corpus.vocabulary.push_back(stem + to_string(i));
+        }
+    }
+    for (int id = 0; id < DOCUMENT_COUNT; ++id) {
+        vector<string> words;
+        string text;
+        const int word_count = 1 + generator() % 8;
+        for (int i = 0; i < word_count; ++i) {
+            // Zipf-like skew, so terms range from rare to frequent
+            const size_t index = min<size_t>(generator() % corpus.vocabulary.size(), generator() % corpus.vocabulary.size());
+            words.push_back(corpus.vocabulary[index]);
+            text += words.back() + " "s;
+            if (generator() % 4 == 0) {
+                text += STOP_WORD + " "s;
+            }
+        }
+        corpus.documents.push_back(move(words));
+        corpus.texts.push_back(move(text));
+        corpus.ratings.push_back(static_cast<int>(generator() % 5) - 2);
+    }
+    return corpus;
+}
+
+QueryNode MakeLeaf(mt19937& generator, const Corpus& corpus, Occur occur) {
+    QueryNode leaf;
+    leaf.occur = occur;
+    const int kind = generator() % 10;
+    if (kind == 0) {
+        leaf.term = STOP_WORD;
+    } else if (kind <= 2) {
+        static const vector<string> prefixes = {"a"s, "b"s, "ba"s, "bb1"s, "c7"s, "d"s};
+        leaf.term = prefixes[generator() % prefixes.size()];
+        leaf.is_prefix = true;
+    } else {
+        leaf.term = corpus.vocabulary[generator() % corpus.vocabulary.size()];
+    }
+    return leaf;
+}
+
+Occur RandomOccur(mt19937& generator) {
+    const int value = generator() % 6;
+    return value < 2 ? Occur::MUST : value < 5 ? Occur::SHOULD : Occur::MUST_NOT;
+}
+
+QueryNode MakeGroup(mt19937& generator, const Corpus& corpus, Occur occur, int depth) {
+    QueryNode group;
+    group.occur = occur;
+    const int member_count = 1 + generator() % 4;
+    for (int i = 0; i < member_count; ++i) {
+        const Occur member_occur = RandomOccur(generator);
+        if (depth < 3 && generator() % 4 == 0) {
+            group.members.push_back(MakeGroup(generator, corpus, member_occur, depth + 1));
+        } else {
+            group.members.push_back(MakeLeaf(generator, corpus, member_occur));
+        }
+    }
+    return group;
+}
+
+QueryNode MakeQuery(mt19937& generator, const Corpus& corpus) {
+    QueryNode root;
+    const int item_count = 1 + generator() % 5;
+    for (int i = 0; i < item_count; ++i) {
+        const Occur occur = RandomOccur(generator);
+        if (generator() % 3 == 0) {
+            root.members.push_back(MakeGroup(generator, corpus, occur, 2));
+        } else {
+            root.members.push_back(MakeLeaf(generator, corpus, occur));
+        }
+    }
+    return root;
+}
+
+void AppendTokens(const QueryNode& node, vector<string>& tokens) {
+    const string sign = node.occur == Occur::MUST ? "+"s : node.occur == Occur::MUST_NOT ? "-"s : ""s;
+    if (!node.term.empty()) {
+        tokens.push_back(sign + node.term + (node.is_prefix ? "*"s : ""s));
+        return;
+    }
+    tokens.push_back(sign + "("s);
+    for (const QueryNode& member : node.members) {
+        AppendTokens(member, tokens);
+    }
+    tokens.push_back(")"s);
+}
+
+// Sometimes glues parentheses to their neighbours, "+(a1 b2)" as well as "+( a1 b2 )"
+string RenderQuery(const QueryNode& root, mt19937& generator) {
+    vector<string> tokens;
+    for (const QueryNode& member : root.members) {
+        AppendTokens(member, tokens);
+    }
+    string text;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const bool glue = i > 0 && (tokens[i - 1].back() == '(' || tokens[i] == ")"s) && generator() % 2 == 0;
+        if (i > 0 && !glue) {
+            text += ' ';
+        }
+        text += tokens[i];
+    }
+    return text;
+}
+
+// Drops stop words and the groups left empty, as the parser does
+optional<QueryNode> Normalize(const QueryNode& node) {
+    if (!node.term.empty()) {
+        if (!node.is_prefix && node.term == STOP_WORD) {
+            return nullopt;
+        }
+        return node;
+    }
+    QueryNode group = node;
+    group.members.clear();
+    for (const QueryNode& member : node.members) {
+        if (auto normalized = Normalize(member)) {
+            group.members.push_back(move(*normalized));
+        }
+    }
+    if (group.members.empty()) {
+        return nullopt;
+    }
+    return group;
+}
+
+template <typename Ranking>
+class BruteForce {
+public:
+    explicit BruteForce(const Corpus& corpus) : corpus_(corpus), ranking_(MakeRanking(corpus)) {
+    }
+
+    map<int, double> FindAll(const QueryNode& root) const {
+        map<int, double> relevances;
+        auto normalized = Normalize(root);
+        if (!normalized) {
+            return relevances;
+        }
+        // The parser merges repeated top-level optional words and prefixes, groups keep them
+        set<pair<string, bool>> optional_leaves;
+        auto& members = normalized->members;
+        members.erase(remove_if(members.begin(), members.end(), [&optional_leaves](const QueryNode& member) {
+            return !member.term.empty() && member.occur == Occur::SHOULD && !optional_leaves.emplace(member.term, member.is_prefix).second;
+        }), members.end());
+        for (int id = 0; id < static_cast<int>(corpus_.documents.size()); ++id) {
+            if (const auto relevance = Score(*normalized, id)) {
+                relevances[id] = *relevance;
+            }
+        }
+        return relevances;
+    }
+
+private:
+    const Corpus& corpus_;
+    Ranking ranking_;
+    mutable map<pair<string, bool>, size_t> document_freqs_;
+
+    static Ranking MakeRanking(const Corpus& corpus) {
+        size_t total_length = 0;
+        for (const auto& words : corpus.documents) {
+            total_length += words.size();
+        }
+        return Ranking(corpus.documents.size(), total_length * 1.0 / corpus.documents.size());
+    }
+
+    bool Expands(const QueryNode& leaf, const string& word) const {
+        return leaf.is_prefix ? word.compare(0, leaf.term.size(), leaf.term) == 0 : word == leaf.term;
+    }
+
+    double TermFreq(const QueryNode& leaf, int id) const {
+        const auto& words = corpus_.documents[id];
+        const auto count = count_if(words.begin(), words.end(), [this, &leaf](const string& word) {
+            return Expands(leaf, word);
+        });
+        return count * 1.0 / words.size();
+    }
+
+    size_t DocumentFreq(const QueryNode& leaf) const {
+        const auto key = make_pair(leaf.term, leaf.is_prefix);
+        if (const auto it = document_freqs_.find(key); it != document_freqs_.end()) {
+            return it->second;
+        }
+        size_t document_freq = 0;
+        for (int id = 0; id < static_cast<int>(corpus_.documents.size()); ++id) {
+            document_freq += TermFreq(leaf, id) > 0.0;
+        }
+        document_freqs_[key] = document_freq;
+        return document_freq;
+    }
+
+    optional<double> Score(const QueryNode& node, int id) const {
+        if (!node.term.empty()) {
+            const double term_freq = TermFreq(node, id);
+            if (term_freq == 0.0) {
+                return nullopt;
+            }
+            const double inverse_document_freq = ranking_.ComputeInverseDocumentFreq(DocumentFreq(node));
+            return ranking_.ComputeScore(term_freq, inverse_document_freq, corpus_.documents[id].size());
+        }
+
+        double relevance = 0.0;
+        bool has_required = false;
+        bool matched_optional = false;
+        for (const QueryNode& member : node.members) {
+            const auto member_relevance = Score(member, id);
+            if (member.occur == Occur::MUST) {
+                if (!member_relevance) {
+                    return nullopt;
+                }
+                relevance += *member_relevance;
+                has_required = true;
+            } else if (member.occur == Occur::MUST_NOT) {
+                if (member_relevance) {
+                    return nullopt;
+                }
+            } else if (member_relevance) {
+                relevance += *member_relevance;
+                matched_optional = true;
+            }
+        }
+        if (!has_required && !matched_optional) {
+            return nullopt;
+        }
+        return relevance;
+    }
+};
+
+bool IsClose(double lhs, double rhs) {
+    return abs(lhs - rhs) <= 1e-9 * max(1.0, abs(rhs));
+}
+
+void CheckMatches(const vector<Document>& documents, const map<int, double>& expected, const string& context) {
+    Check(documents.size() == expected.size(), context + ": "s + to_string(documents.size()) + " documents instead of "s + to_string(expected.size()));
+    for (const Document& document : documents) {
+        const auto it = expected.find(document.id);
+        Check(it != expected.end(), context + ": unexpected document "s + to_string(document.id));
+        Check(IsClose(document.relevance, it->second), context + ": relevance of document "s + to_string(document.id));
+    }
+}
+
+void CheckTop(const vector<Document>& top, const vector<Document>& ranking, const string& context) {
+    Check(top.size() == min<size_t>(MAX_RESULT_DOCUMENT_COUNT, ranking.size()), context + ": wrong result count"s);
+    for (size_t i = 0; i < top.size(); ++i) {
+        Check(top[i].id == ranking[i].id && IsClose(top[i].relevance, ranking[i].relevance), context + ": wrong document at "s + to_string(i));
+    }
+}
+
+
+// Short documents mix with long ones, so position lists run past many skip entries
+vector<vector<string>> MakePositionalCorpus(mt19937& generator, int document_count) {
+    vector<vector<string>> documents;
+    for (int id = 0; id < document_count; ++id) {
+        const int length = id % 10 == 0 ? 200 + generator() % 200 : 1 + generator() % 30;
+        vector<string> words;
+        for (int i = 0; i < length; ++i) {
+            words.push_back(generator() % 5 == 0 ? STOP_WORD : "p"s + to_string(generator() % 5));
+        }
+        documents.push_back(move(words));
+    }
+    return documents;
+}
+
+string JoinWords(const vector<string>& words) {
+    string text;
+    for (const string& word : words) {
+        text += (text.empty() ? ""s : " "s) + word;
+    }
+    return text;
+}
+
+// Stop words of the phrase match any word, leading and trailing ones match nothing at all
+bool BruteForceContainsPhrase(const vector<string>& document, vector<string> phrase) {
+    while (!phrase.empty() && phrase.back() == STOP_WORD) {
+        phrase.pop_back();
+    }
+    while (!phrase.empty() && phrase.front() == STOP_WORD) {
+        phrase.erase(phrase.begin());
+    }
+    for (size_t start = 0; !phrase.empty() && start + phrase.size() <= document.size(); ++start) {
+        bool matches = true;
+        for (size_t i = 0; i < phrase.size() && matches; ++i) {
+            matches = phrase[i] == STOP_WORD || document[start + i] == phrase[i];
+        }
+        if (matches) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BruteForceContainsNear(const vector<string>& document, const string& lhs, const string& rhs, int distance) {
+    for (int i = 0; i < static_cast<int>(document.size()); ++i) {
+        for (int j = max(0, i - distance); j <= min<int>(document.size() - 1, i + distance); ++j) {
+            if (document[i] == lhs && document[j] == rhs) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+set<int> FindAllIds(const SearchServer& search_server, const string& raw_query, int document_count) {
+    set<int> ids;
+    for (const Document& document : search_server.FindTopDocumentsPage(raw_query, document_count).documents) {
+        ids.insert(document.id);
+    }
+    return ids;
+}
+
+void CheckPositionalQueries(mt19937& generator, const SearchServer& search_server, const map<int, vector<string>>& documents, int document_count) {
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        set<int> expected;
+        string raw_query;
+        if (i % 2 == 0) {
+            // Repeated words are frequent with five distinct ones
+            vector<string> phrase;
+            const int length = 2 + generator() % 4;
+            for (int j = 0; j < length; ++j) {
+                phrase.push_back(j > 0 && j + 1 < length && generator() % 4 == 0 ? STOP_WORD : "p"s + to_string(generator() % 5));
+            }
+            raw_query = "\""s + JoinWords(phrase) + "\""s;
+            for (const auto& [id, words] : documents) {
+                if (BruteForceContainsPhrase(words, phrase)) {
+                    expected.insert(id);
+                }
+            }
+        } else {
+            const string lhs = "p"s + to_string(generator() % 5);
+            const string rhs = "p"s + to_string(generator() % 5);
+            const int distance = generator() % 6;
+            raw_query = lhs + " NEAR/"s + to_string(distance) + " "s + rhs;
+            for (const auto& [id, words] : documents) {
+                if (BruteForceContainsNear(words, lhs, rhs, distance)) {
+                    expected.insert(id);
+                }
+            }
+        }
+        Check(FindAllIds(search_server, raw_query, document_count) == expected, "query "s + raw_query + ": wrong documents"s);
+        if (i % 2 == 1) {
+            // NEAR is symmetric, the swapped operands must find the same documents
+            const auto near = raw_query.find(" NEAR/"s);
+            const auto rhs_begin = raw_query.rfind(' ') + 1;
+            const string swapped = raw_query.substr(rhs_begin) + raw_query.substr(near, rhs_begin - near) + raw_query.substr(0, near);
+            Check(FindAllIds(search_server, swapped, document_count) == expected, "query "s + swapped + ": wrong documents"s);
+        }
+    }
+}
+
+}
+
+void TestBooleanQueriesAgainstBruteForce() {
+    mt19937 generator(2026);
+    const Corpus corpus = MakeCorpus(generator);
+
+    SearchServer search_server(STOP_WORD);
+    ShardedSearchServer sharded_server(STOP_WORD, 3);
+    for (int id = 0; id < DOCUMENT_COUNT; ++id) {
+        search_server.AddDocument(id, corpus.texts[id], DocumentStatus::ACTUAL, {corpus.ratings[id]});
+        sharded_server.AddDocument(id, corpus.texts[id], DocumentStatus::ACTUAL, {corpus.ratings[id]});
+    }
+    const BruteForce<TfIdfRanking> tf_idf(corpus);
+    const BruteForce<Bm25Ranking> bm25(corpus);
+
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        const QueryNode query = MakeQuery(generator, corpus);
+        const string raw_query = RenderQuery(query, generator);
+        const string context = "query \""s + raw_query + "\""s;
+
+        // A page holding every document is the whole ranking
+        const auto ranking = search_server.FindTopDocumentsPage(raw_query, DOCUMENT_COUNT).documents;
+        const auto expected = tf_idf.FindAll(query);
+        CheckMatches(ranking, expected, context);
+        CheckMatches(search_server.FindTopDocumentsPage<Bm25Ranking>(raw_query, DOCUMENT_COUNT).documents, bm25.FindAll(query), context + " BM25"s);
+
+        CheckTop(search_server.FindTopDocuments(raw_query), ranking, context + " seq"s);
+        CheckTop(search_server.FindTopDocuments(execution::par, raw_query), ranking, context + " par"s);
+        CheckTop(sharded_server.FindTopDocuments(raw_query), ranking, context + " sharded"s);
+
+        vector<Document> paged;
+        string cursor;
+        for (int page = 0; page < 10; ++page) {
+            const auto result = search_server.FindTopDocumentsPage(raw_query, 7, cursor);
+            paged.insert(paged.end(), result.documents.begin(), result.documents.end());
+            cursor = result.next_cursor;
+            if (cursor.empty()) {
+                break;
+            }
+        }
+        Check(paged.size() == min<size_t>(70, ranking.size()), context + " paged: wrong document count"s);
+        for (size_t j = 0; j < paged.size(); ++j) {
+            Check(paged[j].id == ranking[j].id, context + " paged: wrong document at "s + to_string(j));
+        }
+
+        for (int id = i % 10; id < DOCUMENT_COUNT; id += DOCUMENT_COUNT / 10) {
+            const bool is_match = expected.count(id) > 0;
+            Check(get<0>(search_server.MatchDocument(raw_query, id)).empty() != is_match, context + " MatchDocument seq "s + to_string(id));
+            Check(get<0>(search_server.MatchDocument(execution::par, raw_query, id)).empty() != is_match, context + " MatchDocument par "s + to_string(id));
+        }
+    }
+}
+
+void TestNearOperandsAreValidated() {
+    SearchServer search_server(STOP_WORD);
+    search_server.EnablePositionalIndex();
+    search_server.AddDocument(1, "cat in a hat"s, DocumentStatus::ACTUAL, {1});
+    Check(search_server.FindTopDocuments("cat NEAR/3 hat"s).size() == 1, "plain NEAR operands must be accepted"s);
+
+    for (const string& raw_query : {"+cat NEAR/2 hat"s, "cat NEAR/2 +hat"s, "(cat in) NEAR/2 hat"s, "cat NEAR/2 (hat)"s, "cat NEAR/2"s, "NEAR/2 hat"s,
+             "+\"cat in\""s, "-\"cat hat\" dog"s, "cat (+\"in a\" hat)"s}) {
+        bool rejected = false;
+        try {
+            search_server.FindTopDocuments(raw_query);
+        } catch (const invalid_argument&) {
+            rejected = true;
+        }
+        Check(rejected, "query \""s + raw_query + "\" must be rejected"s);
+    }
+}
+
+void TestPositionListSkipTo() {
+    mt19937 generator(2026);
+    for (int list_index = 0; list_index < 200; ++list_index) {
+        // Gaps up to 2^21 need three varint bytes
+        vector<uint32_t> positions;
+        uint32_t position = generator() % 4;
+        const int size = 1 + generator() % 300;
+        for (int i = 0; i < size; ++i) {
+            positions.push_back(position);
+            position += 1 + (generator() % 8 == 0 ? generator() % (1u << 21) : generator() % 16);
+        }
+        PositionList list;
+        for (const uint32_t value : positions) {
+            list.Append(value);
+        }
+        Check(list.Size() == positions.size(), "PositionList: wrong size"s);
+
+        vector<uint32_t> decoded;
+        for (auto cursor = list.GetCursor(); !cursor.AtEnd(); cursor.Next()) {
+            decoded.push_back(cursor.Value());
+        }
+        Check(decoded == positions, "PositionList: wrong decoded positions"s);
+
+        auto cursor = list.GetCursor();
+        uint32_t target = 0;
+        while (true) {
+            target += generator() % 3 == 0 ? 0 : generator() % (generator() % 2 == 0 ? 32 : 1u << 20);
+            // Targets never decrease, so the cursor always stands on the first position not less than the target
+            cursor.SkipTo(target);
+            const auto expected = lower_bound(positions.begin(), positions.end(), target);
+            if (expected == positions.end()) {
+                Check(cursor.AtEnd(), "PositionList: SkipTo passed the last position"s);
+                break;
+            }
+            Check(!cursor.AtEnd() && cursor.Value() == *expected, "PositionList: SkipTo("s + to_string(target) + ") stopped at a wrong position"s);
+        }
+    }
+}
+
+void TestPositionalQueriesAgainstBruteForce() {
+    const int document_count = 400;
+    mt19937 generator(2026);
+    const auto corpus = MakePositionalCorpus(generator, document_count);
+
+    SearchServer search_server(STOP_WORD);
+    search_server.EnablePositionalIndex();
+    map<int, vector<string>> documents;
+    for (int id = 0; id < document_count; ++id) {
+        search_server.AddDocument(id, JoinWords(corpus[id]), DocumentStatus::ACTUAL, {1});
+        documents[id] = corpus[id];
+    }
+    CheckPositionalQueries(generator, search_server, documents, document_count);
+
+    // Removed documents must leave no positions behind
+    for (int id = 0; id < document_count; id += 3) {
+        search_server.RemoveDocument(id);
+        documents.erase(id);
+    }
+    CheckPositionalQueries(generator, search_server, documents, document_count);
+}
+
+void TestCorpusLoaderMatchesAddDocument() {
+    const filesystem::path path = filesystem::temp_directory_path() / ("search_server_corpus_"s + to_string(getpid()) + ".tsv"s);
+    const size_t chunk_size = 4 << 20; // CHUNK_SIZE of corpus_loader.cpp
+
+    ofstream(path).close();
+    SearchServer empty_server(STOP_WORD);
+    Check(LoadCorpus(empty_server, path.string()) == 0 && empty_server.GetDocumentCount() == 0, "LoadCorpus: an empty file must add nothing"s);
+
+    mt19937 generator(2026);
+    SearchServer expected_server(STOP_WORD);
+    string data;
+    bool spans_chunk_boundary = false;
+    int id = 0;
+    while (data.size() < chunk_size + chunk_size / 8) {
+        const DocumentStatus status = id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        vector<int> ratings;
+        // An empty ratings field, "-" or two to four ratings
+        string ratings_text = id % 5 == 1 ? "-"s : ""s;
+        for (int i = 0; id % 5 > 1 && i < id % 5; ++i) {
+            ratings.push_back(static_cast<int>(generator() % 21) - 10);
+            ratings_text += (i > 0 ? ","s : ""s) + to_string(ratings.back());
+        }
+        string text;
+        const int word_count = 40 + generator() % 80;
+        for (int i = 0; i < word_count; ++i) {
+            text += (i > 0 ? " "s : ""s) + (generator() % 6 == 0 ? STOP_WORD : "w"s + to_string(generator() % 50));
+        }
+        expected_server.AddDocument(id, text, status, ratings);
+
+        const size_t record_begin = data.size();
+        data += to_string(id) + "\t"s + (status == DocumentStatus::BANNED ? "BANNED"s : "ACTUAL"s) + "\t"s + ratings_text + "\t"s + text;
+        spans_chunk_boundary = spans_chunk_boundary || (record_begin < chunk_size && data.size() > chunk_size);
+        data += id % 3 == 0 ? "\r\n"s : "\n"s;
+        if (id % 11 == 0) {
+            data += id % 2 == 0 ? "\n"s : "\r\n"s;
+        }
+        ++id;
+    }
+    // The last record has no line end
+    expected_server.AddDocument(id, "w1 w2"s, DocumentStatus::ACTUAL, {});
+    data += to_string(id) + "\tACTUAL\t-\tw1 w2"s;
+    Check(spans_chunk_boundary, "LoadCorpus: no record spans the chunk boundary"s);
+    ofstream(path, ios::binary) << data;
+
+    SearchServer search_server(STOP_WORD);
+    const size_t added = LoadCorpus(search_server, path.string());
+    filesystem::remove(path);
+    Check(added == static_cast<size_t>(id + 1) && search_server.GetDocumentCount() == id + 1, "LoadCorpus: wrong document count"s);
+
+    for (int document_id = 0; document_id <= id; ++document_id) {
+        const auto& freqs = search_server.GetWordFrequencies(document_id);
+        const auto& expected_freqs = expected_server.GetWordFrequencies(document_id);
+        Check(equal(freqs.begin(), freqs.end(), expected_freqs.begin(), expected_freqs.end()), "LoadCorpus: wrong words of document "s + to_string(document_id));
+    }
+    for (const string& raw_query : {"w1 w2"s, "w7 -w3"s, "+w4 w4*"s, "w1*"s}) {
+        for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+            const auto documents = search_server.FindTopDocumentsPage(raw_query, status, id + 1).documents;
+            const auto expected = expected_server.FindTopDocumentsPage(raw_query, status, id + 1).documents;
+            Check(equal(documents.begin(), documents.end(), expected.begin(), expected.end(), [](const Document& lhs, const Document& rhs) {
+                return lhs.id == rhs.id && lhs.relevance == rhs.relevance && lhs.rating == rhs.rating;
+            }), "LoadCorpus: wrong results for query "s + raw_query);
+        }
+    }
+}
+
+namespace {
+
+size_t ExpectedLatencyBucket(chrono::steady_clock::duration latency) {
+    const auto micros = chrono::duration_cast<chrono::microseconds>(latency).count();
+    size_t bucket = 0;
+    while (bucket + 1 < LATENCY_BUCKET_COUNT && (int64_t{2} << bucket) <= micros) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+uint64_t SumLatencyBuckets(const RequestStats& stats) {
+    uint64_t sum = 0;
+    for (const uint64_t count : stats.latency_buckets) {
+        sum += count;
+    }
+    return sum;
+}
+
+}
+
+void TestRequestQueueTotalsFromThreads() {
+    const int thread_count = 8;
+    const int requests_per_thread = 500;
+    SearchServer search_server(STOP_WORD);
+    search_server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "dog and cat"s, DocumentStatus::ACTUAL, {2});
+    RequestQueue request_queue(search_server);
+
+    // Every thread asks two documents, one document and nothing in turn
+    vector<thread> threads;
+    for (int i = 0; i < thread_count; ++i) {
+        threads.emplace_back([&request_queue] {
+            for (int j = 0; j < requests_per_thread; ++j) {
+                request_queue.AddFindRequest(j % 3 == 0 ? "cat"s : j % 3 == 1 ? "dog"s : "bird"s);
+                if (j % 50 == 0) {
+                    request_queue.GetStats();
+                }
+            }
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+
+    const RequestStats stats = request_queue.GetStats();
+    const uint64_t total = thread_count * requests_per_thread;
+    uint64_t no_result = 0;
+    uint64_t returned = 0;
+    for (int j = 0; j < requests_per_thread; ++j) {
+        no_result += j % 3 == 2;
+        returned += j % 3 == 0 ? 2 : j % 3 == 1 ? 1 : 0;
+    }
+    Check(stats.requests == total, "RequestQueue: wrong request count"s);
+    Check(stats.no_result_requests == thread_count * no_result && request_queue.GetNoResultRequests() == static_cast<int>(thread_count * no_result), "RequestQueue: wrong no-result count"s);
+    Check(stats.returned_documents == thread_count * returned, "RequestQueue: wrong returned document count"s);
+    Check(SumLatencyBuckets(stats) == total, "RequestQueue: latency buckets do not add up to the request count"s);
+}
+
+void TestRequestQueueWindowExpires() {
+    const auto slot_duration = chrono::microseconds(400);
+    const size_t slot_count = 8;
+    SearchServer search_server(STOP_WORD);
+    search_server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    RequestQueue request_queue(search_server, slot_duration, slot_count);
+
+    // Slots are recycled by recording threads while readers expire them
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&request_queue, i] {
+            const auto end = chrono::steady_clock::now() + chrono::milliseconds(30);
+            while (chrono::steady_clock::now() < end) {
+                if (i == 0) {
+                    request_queue.GetStats();
+                } else {
+                    request_queue.AddFindRequest(i % 2 == 0 ? "cat"s : "dog"s);
+                }
+            }
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+
+    this_thread::sleep_for(slot_duration * slot_count * 2);
+    const RequestStats stats = request_queue.GetStats();
+    Check(stats.requests == 0 && stats.no_result_requests == 0 && stats.returned_documents == 0 && SumLatencyBuckets(stats) == 0, "RequestQueue: totals must return to zero once the window has passed"s);
+}
+
+void TestRequestQueueLatencyBuckets() {
+    SearchServer search_server(STOP_WORD);
+    search_server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    RequestQueue request_queue(search_server);
+
+    // The predicate runs once, so the request takes at least its delay
+    for (const auto delay : {chrono::milliseconds(3), chrono::milliseconds(20)}) {
+        const RequestStats before = request_queue.GetStats();
+        const auto start = chrono::steady_clock::now();
+        request_queue.AddFindRequest("cat"s, [delay](int, DocumentStatus, int) {
+            this_thread::sleep_for(delay);
+            return true;
+        });
+        const auto elapsed = chrono::steady_clock::now() - start;
+        const RequestStats after = request_queue.GetStats();
+
+        size_t bucket = LATENCY_BUCKET_COUNT;
+        for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+            if (after.latency_buckets[i] != before.latency_buckets[i]) {
+                Check(bucket == LATENCY_BUCKET_COUNT && after.latency_buckets[i] == before.latency_buckets[i] + 1, "RequestQueue: one request changed several latency buckets"s);
+                bucket = i;
+            }
+        }
+        Check(bucket >= ExpectedLatencyBucket(delay) && bucket <= ExpectedLatencyBucket(elapsed), "RequestQueue: a "s + to_string(delay.count()) + " ms request is in latency bucket "s + to_string(bucket));
+    }
+}
+
+void TestQuotedWordsAreLiteral() {
+    SearchServer search_server(STOP_WORD);
+    search_server.EnablePositionalIndex();
+    search_server.AddDocument(1, "alpha (beta) foo) +1 -2 ca* and"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "beta foo 1 2 cat"s, DocumentStatus::ACTUAL, {1});
+
+    // Unquoted, these are query syntax and must not reach the literal words
+    for (const string& word : {"(beta)"s, "foo)"s, "+1"s, "-2"s, "ca*"s}) {
+        const string raw_query = "\""s + word + "\""s;
+        const auto documents = search_server.FindTopDocuments(raw_query);
+        Check(documents.size() == 1 && documents[0].id == 1, "query "s + raw_query + " must find the document holding "s + word);
+        const auto [matched_words, status] = search_server.MatchDocument(raw_query, 1);
+        Check(matched_words == vector<string_view>{word}, "query "s + raw_query + ": wrong matched words"s);
+    }
+    const auto documents = search_server.FindTopDocuments("\"alpha (beta) foo)\" cat"s);
+    Check(documents.size() == 1 && documents[0].id == 1, "a phrase of words with parentheses must be matched literally"s);
+    Check(search_server.FindTopDocuments("\"(beta) alpha\""s).empty(), "a phrase of literal words must keep its order"s);
+}
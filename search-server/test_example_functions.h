@@ -1 +1,32 @@
-#pragma once
\ No newline at end of file
+#pragma once
+
+// Random boolean queries (+term, -term, prefix*, nested groups) against a brute-force
+// evaluation of the same query tree; covers the sequential, parallel, BM25, paged,
+// MatchDocument and sharded paths. Throws std::logic_error on the first mismatch.
+void TestBooleanQueriesAgainstBruteForce();
+
+// NEAR with anything but two plain words and phrases with a '+' or '-' must be rejected
+void TestNearOperandsAreValidated();
+
+// Random SkipTo targets over varint position lists of up to a few hundred entries
+void TestPositionListSkipTo();
+
+// Phrases with stop-word gaps and repeated words, NEAR/k in both word orders, before and
+// after RemoveDocument, against a scan of the document words
+void TestPositionalQueriesAgainstBruteForce();
+
+// A temporary corpus with CRLF and blank lines, empty and "-" ratings and a record across
+// the loader's chunk boundary must index exactly like AddDocument; an empty file adds nothing
+void TestCorpusLoaderMatchesAddDocument();
+
+// Exact RequestQueue totals after concurrent AddFindRequest calls from several threads
+void TestRequestQueueTotalsFromThreads();
+
+// A 3.2 ms window recorded and read concurrently must drop back to zero totals once it has passed
+void TestRequestQueueWindowExpires();
+
+// Requests slowed down by a sleeping predicate land in the log2 bucket of their duration
+void TestRequestQueueLatencyBuckets();
+
+// Quoted words are searched literally, so indexed words such as (beta), +1 or ca* stay reachable
+void TestQuotedWordsAreLiteral();
@@ -0,0 +1,25 @@
+#include "test_example_functions.h"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    try {
+        TestNearOperandsAreValidated();
+        TestQuotedWordsAreLiteral();
+        TestPositionListSkipTo();
+        TestPositionalQueriesAgainstBruteForce();
+        TestCorpusLoaderMatchesAddDocument();
+        TestRequestQueueTotalsFromThreads();
+        TestRequestQueueWindowExpires();
+        TestRequestQueueLatencyBuckets();
+        TestBooleanQueriesAgainstBruteForce();
+    } catch (const exception& e) {
+        cerr << "FAILED: "s << e.what() << endl;
+        return 1;
+    }
+    cerr << "Tests passed"s << endl;
+    return 0;
+}